@@ -0,0 +1,1159 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright (c) 2025 TAO 12804985@qq.com
+ *
+ * @file    ansi_color_core.hpp
+ * @brief   核心部分: AnsiLiteral / SGR 代码 / 4-8-24 位颜色 / OSC / TTY 策略,
+ *          以及不依赖 <iostream> 与 <format> 的文件描述符输出
+ * @version 1.2.0
+ * @date    2025-10-04
+ * 
+ * -----------------------------------------------------------------------------
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * -----------------------------------------------------------------------------
+ */
+
+/*
+ +---------+---------------------------+-------------------------------+-----------------------------------+
+ | Family  | Introducer                | Terminator                    | Common Usage                      |
+ +---------+---------------------------+-------------------------------+-----------------------------------+
+ | ESC     | ESC + single character    | Single character              | Cursor up (ESC A), down (ESC B),  |
+ |         |                           |                               | index, next line, etc.            |
+ | CSI     | ESC [                     | Letter (m, J, K, H, A, B, C…) | Colors/styles (SGR), clear screen,|
+ |         |                           |                               | cursor movement                   |
+ | OSC     | ESC ]                     | BEL (\x07) or ESC \           | Set window title, clipboard,      |
+ |         |                           |                               | hyperlinks                        |
+ | DCS     | ESC P                     | ESC \                         | Device control, graphics (sixel,  |
+ |         |                           |                               | kitty protocol, etc.)             |
+ | ST      | ESC \                     | (used as terminator)          | Terminates OSC/DCS strings        |
+ +---------+---------------------------+-------------------------------+-----------------------------------+
+ 
+ +----------------------+-----------------------------+-----------------------------+
+ | SGR Code             | Foreground (text color)     | Background (fill color)     |
+ +----------------------+-----------------------------+-----------------------------+
+ | 30–37                | 30 Black        31 Red      | 40 Black        41 Red      |
+ |                      | 32 Green        33 Yellow   | 42 Green        43 Yellow   |
+ |                      | 34 Blue         35 Magenta  | 44 Blue         45 Magenta  |
+ |                      | 36 Cyan         37 White    | 46 Cyan         47 White    |
+ +----------------------+-----------------------------+-----------------------------+
+ | 90–97 (bright)       | 90 BrightBlack  91 BrightRed|100 BrightBlack 101 BrightRed|
+ |                      | 92 BrightGreen  93 BrightYel|102 BrightGreen 103 BrightYel|
+ |                      | 94 BrightBlue   95 BrightMag|104 BrightBlue  105 BrightMag|
+ |                      | 96 BrightCyan   97 BrightWhi|106 BrightCyan  107 BrightWhi|
+ +----------------------+-----------------------------+-----------------------------+
+ | 38;5;{idx}           | 8-bit (256-color) FG        |                             |
+ | 48;5;{idx}           |                             | 8-bit (256-color) BG        |
+ |                      | {idx} in [0..255]           | {idx} in [0..255]           |
+ +----------------------+-----------------------------+-----------------------------+
+ | 38;2;R;G;B           | 24-bit truecolor FG         |                             |
+ | 48;2;R;G;B           |                             | 24-bit truecolor BG         |
+ |                      | R,G,B in [0..255]           | R,G,B in [0..255]           |
+ +----------------------+-----------------------------+-----------------------------+
+ | 0                    | Reset all attributes        |                             |
+ | 39                   | Reset foreground to default |                             |
+ | 49                   |                             | Reset background to default |
+ +----------------------+-----------------------------+-----------------------------+
+ | 1 Bold/Intensity     | 2 Faint     3 Italic        | 4 Underline                 |
+ | 5 Blink              | 7 Reverse   8 Hidden        | 9 Strikethrough             |
+ +----------------------+-----------------------------+-----------------------------+
+ | 22 Cancel Bold/Faint | 23 Cancel Italic            | 24 Cancel Underline         |
+ | 25 Cancel Blink      | 27 Cancel Reverse           | 28 Cancel Hidden            |
+ | 29 Cancel Strike     |                             |                             |
+ +----------------------+-----------------------------+-----------------------------+
+ */
+
+#pragma once
+
+#define ANSI_COLOR_VERSION "1.0.1"
+
+#if defined(_MSC_VER)  // MSVC
+#if !defined(_MSVC_LANG) || _MSVC_LANG < 202002L
+#error "Compiler must support at least C++20. Please enable C++20 (/std:c++20 or /std:c++latest)"
+#endif
+#else  // GCC / Clang
+#if __cplusplus < 202002L
+#error "Compiler must support at least C++20. Please enable C++20 (-std=c++20)"
+#endif
+#endif
+
+#include <cassert>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#ifdef ANSI_COLOR_ENABLE_STATS
+#include <atomic>
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#define isatty _isatty
+#define fileno _fileno
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+namespace ansi_escape {
+	inline bool enable_windows_ansi() {
+		static bool enabled = []() {
+			HANDLE hOut = ::GetStdHandle(STD_OUTPUT_HANDLE);
+			if (hOut == INVALID_HANDLE_VALUE) return false;
+
+			DWORD target = 0;
+			if (!::GetConsoleMode(hOut, &target)) return false;
+
+			DWORD newMode = target | ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+			if (!::SetConsoleMode(hOut, newMode)) return false;
+			return true;
+			}();
+
+		return enabled;
+	}
+
+	namespace detail {
+		// 依次写出全部缓冲区, 处理部分写入
+		inline bool write_fd(int fd, const std::string_view* bufs, std::size_t count) {
+			for (std::size_t i = 0; i < count; ++i) {
+				for (std::string_view b = bufs[i]; !b.empty(); ) {
+					int w = ::_write(fd, b.data(), static_cast<unsigned>(b.size()));
+					if (w < 0) return false;
+					b.remove_prefix(static_cast<std::size_t>(w));
+				}
+			}
+			return true;
+		}
+	}
+}
+
+#else
+
+#include <cerrno>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace ansi_escape {
+	inline bool enable_windows_ansi() {
+		// 非 Windows 平台默认支持 ANSI
+		return true;
+	}
+
+	namespace detail {
+		// 经 writev 一次系统调用写出全部缓冲区 (每批最多 64 段), 处理部分写入与 EINTR
+		inline bool write_fd(int fd, const std::string_view* bufs, std::size_t count) {
+			while (count > 0) {
+				iovec iov[64];
+				int n = 0;
+				for (; n < 64 && std::size_t(n) < count; ++n)
+					iov[n] = { const_cast<char*>(bufs[n].data()), bufs[n].size() };
+
+				for (int i = 0; i < n; ) {
+					ssize_t w = ::writev(fd, iov + i, n - i);
+					if (w < 0) {
+						if (errno == EINTR) continue;
+						return false;
+					}
+					auto left = std::size_t(w);
+					while (i < n && left >= iov[i].iov_len) left -= iov[i++].iov_len;
+					if (i < n) {
+						iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + left;
+						iov[i].iov_len -= left;
+					}
+				}
+				bufs += n;
+				count -= std::size_t(n);
+			}
+			return true;
+		}
+	}
+}
+
+#endif
+
+namespace ansi_escape {
+
+	template<int N, class CharT = char>
+	struct AnsiLiteral {
+		std::array<CharT, N> value;
+
+		constexpr AnsiLiteral(const std::array<CharT, N>& str) {
+			for (int i = 0; i < N; ++i) value[i] = str[i];
+		}
+
+		constexpr std::basic_string_view<CharT> to_view() const {
+			/*static_assert*/assert(value[0] == '\x1b');
+			return { value.data() };
+		}
+
+		// 转换为其他字符类型 (wchar_t / char8_t / ...), 常量对象可在编译期完成:
+		//   constexpr auto red = fg4::red.widen<wchar_t>();
+		// 转义序列均为 ASCII; Title 文本按字节复制, 对 char8_t 即 UTF-8
+		template <class CharU>
+		constexpr AnsiLiteral<N, CharU> widen() const noexcept {
+			std::array<CharU, N> w{};
+			for (int i = 0; i < N; ++i) w[i] = static_cast<CharU>(static_cast<unsigned char>(value[i]));
+			return w;
+		}
+
+		constexpr const CharT* c_str() const noexcept { return value.data(); }
+		constexpr size_t size() const noexcept { return N; }
+		constexpr size_t length() const noexcept { return N - 1; } // exclude '\0'
+	};
+
+	// 具有 to_view() 的 ANSI 对象, to_view() 返回 CharT 字符串视图
+	template <class T, class CharT = char>
+	concept ansi_object = requires(T&& ao) {
+		{ ao.to_view() } -> std::same_as<std::basic_string_view<CharT>>;
+	};
+
+	namespace tty {
+
+		enum class policy { force, never, auto_ };
+
+		struct state {
+			policy stdout_policy = policy::auto_;
+			policy stderr_policy = policy::auto_;
+			policy stream_policy = policy::auto_;
+
+			bool stdout_is_tty = false;
+			bool stderr_is_tty = false;
+
+			// print / format 调用期间实际输出目标的判定结果, 未设置时按 stream_policy 处理
+			std::optional<bool> target;
+
+			// 其他文件描述符的 isatty 结果缓存: -1 未检测, 0 / 1
+			std::array<signed char, 64> fd_is_tty;
+
+			void refresh() {
+				stdout_is_tty = (isatty(fileno(stdout)) != 0);
+				stderr_is_tty = (isatty(fileno(stderr)) != 0);
+				fd_is_tty.fill(-1);
+			}
+
+			bool is_tty(int fd) {
+				if (fd < 0 || fd >= int(fd_is_tty.size())) return isatty(fd) != 0;
+				if (fd_is_tty[fd] < 0) fd_is_tty[fd] = (isatty(fd) != 0);
+				return fd_is_tty[fd] != 0;
+			}
+
+			state() { refresh(); }
+		};
+
+		inline thread_local state g_tty_state;
+
+		inline auto emit_policy = [](policy p, bool is_tty) {
+			return p == policy::force || (p == policy::auto_ && is_tty);
+			};
+
+		inline bool emit_ansi() {
+			if (g_tty_state.target) return *g_tty_state.target;
+			return emit_policy(g_tty_state.stream_policy, g_tty_state.stdout_is_tty/* && g_tty_state.stderr_is_tty*/);
+		}
+
+		inline bool emit_ansi(std::FILE* f) {
+			if (f == stdout)
+				return emit_policy(g_tty_state.stdout_policy, g_tty_state.stdout_is_tty);
+			else if (f == stderr)
+				return emit_policy(g_tty_state.stderr_policy, g_tty_state.stderr_is_tty);
+			else
+				return emit_policy(g_tty_state.stream_policy, g_tty_state.is_tty(fileno(f)));
+		}
+
+		inline bool emit_ansi(int fd) {
+			if (fd == fileno(stdout))
+				return emit_policy(g_tty_state.stdout_policy, g_tty_state.stdout_is_tty);
+			else if (fd == fileno(stderr))
+				return emit_policy(g_tty_state.stderr_policy, g_tty_state.stderr_is_tty);
+			else
+				return emit_policy(g_tty_state.stream_policy, g_tty_state.is_tty(fd));
+		}
+
+		// 作用域内固定 emit_ansi() 的结果, 使 {} / {:a} 跟随实际输出目标, 可嵌套
+		class scoped_target {
+			std::optional<bool> prev_;
+		public:
+			explicit scoped_target(bool emit) : prev_(g_tty_state.target) { g_tty_state.target = emit; }
+			~scoped_target() { g_tty_state.target = prev_; }
+			scoped_target(const scoped_target&) = delete;
+			scoped_target& operator=(const scoped_target&) = delete;
+		};
+	}
+
+	// 输出统计: 定义 ANSI_COLOR_ENABLE_STATS 时启用, 否则各计数函数为空操作, 不产生任何开销
+	// 按输出目标累计 已输出 / 被策略抑制 的转义序列数, 以及转义字节与文本字节
+	// 文本字节只包含经本库写出的文本 (AnsiText / emit 的 part / print, format(os) 与 format_to 的整条消息)
+	// 读取: stats::read() 返回各目标 (stdout / stderr / other) 的计数, stats::report(FILE*) 输出表格
+	namespace stats {
+
+		enum class sink { out, err, other };
+
+		struct counters {
+			std::uint64_t escapes = 0;      // 已输出的转义序列数
+			std::uint64_t suppressed = 0;   // 因策略未输出的转义序列数
+			std::uint64_t escape_bytes = 0;
+			std::uint64_t text_bytes = 0;
+
+			counters& operator+=(const counters& o) noexcept {
+				escapes += o.escapes; suppressed += o.suppressed;
+				escape_bytes += o.escape_bytes; text_bytes += o.text_bytes;
+				return *this;
+			}
+		};
+
+		struct snapshot {
+			counters out, err, other;
+			counters total() const noexcept { counters t = out; t += err; t += other; return t; }
+		};
+
+#ifdef ANSI_COLOR_ENABLE_STATS
+		inline constexpr bool enabled = true;
+
+		struct atomic_counters {
+			std::atomic<std::uint64_t> escapes{ 0 }, suppressed{ 0 }, escape_bytes{ 0 }, text_bytes{ 0 };
+		};
+
+		inline atomic_counters g_counters[3];
+
+		// 当前 print / format 调用的输出目标, 以及本次调用中已计入的转义字节 (用于推算文本字节)
+		inline thread_local sink g_current = sink::other;
+		inline thread_local std::uint64_t g_call_escape_bytes = 0;
+#else
+		inline constexpr bool enabled = false;
+#endif
+
+		inline sink of(std::FILE* f) noexcept { return f == stdout ? sink::out : f == stderr ? sink::err : sink::other; }
+		inline sink of(int fd) noexcept { return fd == 1 ? sink::out : fd == 2 ? sink::err : sink::other; }
+
+		inline sink current() noexcept {
+#ifdef ANSI_COLOR_ENABLE_STATS
+			return g_current;
+#else
+			return sink::other;
+#endif
+		}
+
+		inline void escape(sink s, std::size_t bytes, std::size_t count = 1) noexcept {
+#ifdef ANSI_COLOR_ENABLE_STATS
+			auto& c = g_counters[static_cast<int>(s)];
+			c.escapes.fetch_add(count, std::memory_order_relaxed);
+			c.escape_bytes.fetch_add(bytes, std::memory_order_relaxed);
+			g_call_escape_bytes += bytes;
+#else
+			(void)s; (void)bytes; (void)count;
+#endif
+		}
+
+		inline void suppressed(sink s, std::size_t count = 1) noexcept {
+#ifdef ANSI_COLOR_ENABLE_STATS
+			g_counters[static_cast<int>(s)].suppressed.fetch_add(count, std::memory_order_relaxed);
+#else
+			(void)s; (void)count;
+#endif
+		}
+
+		inline void text(sink s, std::size_t bytes) noexcept {
+#ifdef ANSI_COLOR_ENABLE_STATS
+			g_counters[static_cast<int>(s)].text_bytes.fetch_add(bytes, std::memory_order_relaxed);
+#else
+			(void)s; (void)bytes;
+#endif
+		}
+
+		// 按是否输出计入一个转义序列
+		inline void sequence(sink s, bool on, std::size_t bytes) noexcept {
+			if (on) escape(s, bytes);
+			else suppressed(s);
+		}
+
+		// 按是否输出计入一段着色文本 (如 AnsiText), 转义序列数按其中的 ESC 计
+		inline void colored_text(sink s, bool on, std::string_view colored, std::size_t plain_len) noexcept {
+#ifdef ANSI_COLOR_ENABLE_STATS
+			const auto n = static_cast<std::size_t>(std::count(colored.begin(), colored.end(), '\x1b'));
+			if (on) escape(s, colored.size() - plain_len, n);
+			else suppressed(s, n);
+			text(s, plain_len);
+#else
+			(void)s; (void)on; (void)colored; (void)plain_len;
+#endif
+		}
+
+		// 一条完整消息 (含转义序列) 写出到 s; 作用域内的格式化计数归于 s,
+		// 结束时以 消息长度 - 期间计入的转义字节 作为文本字节
+		class scoped_call {
+#ifdef ANSI_COLOR_ENABLE_STATS
+			sink prev_;
+			std::uint64_t prev_bytes_;
+		public:
+			explicit scoped_call(sink s) noexcept : prev_(g_current), prev_bytes_(g_call_escape_bytes) {
+				g_current = s;
+				g_call_escape_bytes = 0;
+			}
+			~scoped_call() { g_current = prev_; g_call_escape_bytes += prev_bytes_; }
+			void finish(std::size_t message_bytes) const noexcept {
+				text(g_current, message_bytes - std::min<std::uint64_t>(message_bytes, g_call_escape_bytes));
+			}
+#else
+		public:
+			explicit scoped_call(sink) noexcept {}
+			void finish(std::size_t) const noexcept {}
+#endif
+			scoped_call(const scoped_call&) = delete;
+			scoped_call& operator=(const scoped_call&) = delete;
+		};
+
+		inline snapshot read() noexcept {
+			snapshot r{};
+#ifdef ANSI_COLOR_ENABLE_STATS
+			counters* dst[] = { &r.out, &r.err, &r.other };
+			for (int i = 0; i < 3; ++i) {
+				dst[i]->escapes = g_counters[i].escapes.load(std::memory_order_relaxed);
+				dst[i]->suppressed = g_counters[i].suppressed.load(std::memory_order_relaxed);
+				dst[i]->escape_bytes = g_counters[i].escape_bytes.load(std::memory_order_relaxed);
+				dst[i]->text_bytes = g_counters[i].text_bytes.load(std::memory_order_relaxed);
+			}
+#endif
+			return r;
+		}
+
+		inline void reset() noexcept {
+#ifdef ANSI_COLOR_ENABLE_STATS
+			for (auto& c : g_counters) {
+				c.escapes.store(0, std::memory_order_relaxed);
+				c.suppressed.store(0, std::memory_order_relaxed);
+				c.escape_bytes.store(0, std::memory_order_relaxed);
+				c.text_bytes.store(0, std::memory_order_relaxed);
+			}
+#endif
+		}
+
+		// 以表格形式输出快照, 最后一列为转义字节占总字节的百分比
+		inline void report(std::FILE* f, const snapshot& s = read()) {
+			std::fprintf(f, "%-8s %12s %12s %14s %14s %8s\n", "sink", "escapes", "suppressed", "escape_bytes", "text_bytes", "escape%");
+			auto row = [f](const char* name, const counters& c) {
+				const double all = double(c.escape_bytes + c.text_bytes);
+				std::fprintf(f, "%-8s %12llu %12llu %14llu %14llu %7.1f%%\n", name,
+					(unsigned long long)c.escapes, (unsigned long long)c.suppressed,
+					(unsigned long long)c.escape_bytes, (unsigned long long)c.text_bytes,
+					all > 0 ? 100.0 * double(c.escape_bytes) / all : 0.0);
+				};
+			row("stdout", s.out);
+			row("stderr", s.err);
+			row("other", s.other);
+			row("total", s.total());
+		}
+	}
+
+	namespace detail {
+
+		[[nodiscard]] constexpr int int_to_chars(int value, char* out) noexcept {
+			auto digits = [](int v) {
+				int d = 1;
+				while (v >= 10) { v /= 10; ++d; }
+				return d;
+			};
+
+			int len = digits(value);
+			for (int i = len - 1; i >= 0; --i) {
+				out[i] = char('0' + (value % 10));
+				value /= 10;
+			}
+			return len;
+		}
+
+		template<std::size_t N = 32, typename Write>
+		[[nodiscard]] constexpr auto make_escape(char Introducer, char Finisher, Write&& write) {
+			std::array<char, N> buf{};
+			int pos = 0;
+			buf[pos++] = '\x1b';
+			buf[pos++] = Introducer;
+			write(buf, pos);
+			buf[pos++] = Finisher;
+			buf[pos] = '\0';
+			return buf;
+		}
+
+		struct rgb { uint8_t r, g, b; };
+
+		// 读取 SGR 颜色序列 "\x1b[38;5;{i}m" / "\x1b[38;2;{r};{g};{b}m" 中 "38;5;" / "38;2;" 之后的 K 个参数
+		// 颜色对象不另存下标与 RGB, 需要时从转义文本恢复
+		template <std::size_t K>
+		[[nodiscard]] constexpr std::array<uint8_t, K> color_params(std::string_view seq) noexcept {
+			std::array<uint8_t, K> v{};
+			std::size_t pos = 7;
+			for (auto& x : v) {
+				int n = 0;
+				while (pos < seq.size() && seq[pos] >= '0' && seq[pos] <= '9') n = n * 10 + (seq[pos++] - '0');
+				x = uint8_t(n);
+				++pos;
+			}
+			return v;
+		}
+
+		// xterm 256 色调色板: 0-15 标准色, 16-231 为 6x6x6 色立方, 232-255 为灰阶
+		inline constexpr auto palette_rgb = [] {
+			constexpr uint8_t ansi16[16][3] = {
+				{   0,   0,   0 }, { 205,   0,   0 }, {   0, 205,   0 }, { 205, 205,   0 },
+				{   0,   0, 238 }, { 205,   0, 205 }, {   0, 205, 205 }, { 229, 229, 229 },
+				{ 127, 127, 127 }, { 255,   0,   0 }, {   0, 255,   0 }, { 255, 255,   0 },
+				{  92,  92, 255 }, { 255,   0, 255 }, {   0, 255, 255 }, { 255, 255, 255 },
+			};
+			constexpr uint8_t level[6] = { 0, 95, 135, 175, 215, 255 };
+			std::array<rgb, 256> lut{};
+			for (int i = 0; i < 16; ++i) lut[i] = { ansi16[i][0], ansi16[i][1], ansi16[i][2] };
+			for (int i = 0; i < 216; ++i) lut[16 + i] = { level[i / 36], level[i / 6 % 6], level[i % 6] };
+			for (int i = 0; i < 24; ++i) lut[232 + i] = { uint8_t(8 + 10 * i), uint8_t(8 + 10 * i), uint8_t(8 + 10 * i) };
+			return lut;
+		}();
+
+		[[nodiscard]] constexpr int distance2(rgb a, rgb b) noexcept {
+			int dr = a.r - b.r, dg = a.g - b.g, db = a.b - b.b;
+			return dr * dr + dg * dg + db * db;
+		}
+
+		// 通道值 -> 最近的色立方级别 (0-5) / 灰阶级别 (0-23)
+		inline constexpr auto cube_level = [] {
+			std::array<uint8_t, 256> lut{};
+			for (int v = 0; v < 256; ++v) lut[v] = uint8_t(v < 48 ? 0 : v < 115 ? 1 : (v - 35) / 40);
+			return lut;
+		}();
+		inline constexpr auto gray_level = [] {
+			std::array<uint8_t, 256> lut{};
+			for (int v = 0; v < 256; ++v) lut[v] = uint8_t(v < 8 ? 0 : v > 238 ? 23 : (v - 3) / 10);
+			return lut;
+		}();
+
+		// 256 色下标 -> 最近的 16 色下标
+		inline constexpr auto palette_to_16 = [] {
+			std::array<uint8_t, 256> lut{};
+			for (int i = 0; i < 256; ++i) {
+				int best = 0;
+				for (int j = 1; j < 16; ++j)
+					if (distance2(palette_rgb[i], palette_rgb[j]) < distance2(palette_rgb[i], palette_rgb[best])) best = j;
+				lut[i] = uint8_t(best);
+			}
+			return lut;
+		}();
+
+		// 24 位色 -> 最近的 256 色下标: 色立方与灰阶各查表一次, 取较近者
+		[[nodiscard]] constexpr uint8_t rgb_to_256(rgb c) noexcept {
+			int cube = 16 + 36 * cube_level[c.r] + 6 * cube_level[c.g] + cube_level[c.b];
+			int gray = 232 + gray_level[(c.r + c.g + c.b) / 3];
+			return uint8_t(distance2(c, palette_rgb[gray]) < distance2(c, palette_rgb[cube]) ? gray : cube);
+		}
+    } // namespace detail
+
+    inline void refresh_is_tty() { tty::g_tty_state.refresh(); }
+
+	// Control Sequence Introducer
+	namespace csi {
+        //template<char F>
+        //    requires (
+        //        F == 'm' || F == 'J' || F == 'K' || F == 'A' || 
+        //        F == 'B' || F == 'C' || F == 'D' || F == 'H' || F == 'f')
+		// evaluated at both compile-time and runtime
+		template <int N = 16>
+        [[nodiscard]] constexpr auto gen_ansi(int v, char F) noexcept {
+			// 允许的终止符：SGR(m)、擦屏/擦行(J/K)、光标移动(A/B/C/D)、定位(H/f)        
+			assert((
+				F == 'm' || F == 'J' || F == 'K' ||
+				F == 'A' || F == 'B' || F == 'C' ||
+				F == 'D' || F == 'H' || F == 'f') && "Invalid ANSI command");
+            return detail::make_escape<N>('[', F, [&](auto& buf, int& pos) {
+                pos += detail::int_to_chars(v, buf.data() + pos);
+			});
+        }
+
+        // Select Graphic Rendition
+        namespace sgr {
+
+			template <int N = 16>
+			struct Code : AnsiLiteral<N> {
+				consteval Code(int v) : AnsiLiteral<N>(gen_ansi(v, 'm')) { }
+			};
+
+            enum class target : int { foreground = 38, background = 48 };
+
+			// 4bit color
+			template <target t>
+			class Color4 {
+				Color4() = delete;
+				enum { base_c = static_cast<int>(t) - 8, bright_c = base_c + 60 };
+
+			public:
+                // 缺省色
+				inline static constexpr auto preset = Code(base_c + 9);
+				// 4位基础色                                             // 4位亮色
+				inline static constexpr auto black   = Code(base_c + 0); inline static constexpr auto bright_black   = Code(bright_c + 0);
+				inline static constexpr auto red     = Code(base_c + 1); inline static constexpr auto bright_red     = Code(bright_c + 1);
+				inline static constexpr auto green   = Code(base_c + 2); inline static constexpr auto bright_green   = Code(bright_c + 2);
+				inline static constexpr auto yellow  = Code(base_c + 3); inline static constexpr auto bright_yellow  = Code(bright_c + 3);
+				inline static constexpr auto blue    = Code(base_c + 4); inline static constexpr auto bright_blue    = Code(bright_c + 4);
+				inline static constexpr auto magenta = Code(base_c + 5); inline static constexpr auto bright_magenta = Code(bright_c + 5);
+				inline static constexpr auto cyan    = Code(base_c + 6); inline static constexpr auto bright_cyan    = Code(bright_c + 6);
+				inline static constexpr auto white   = Code(base_c + 7); inline static constexpr auto bright_white   = Code(bright_c + 7);
+			};
+
+			// 256 色 SGR 表 "\x1b[38;5;{i}m" / "\x1b[48;5;{i}m", 所有 Color8<t, N> 共用
+			// 前景表以单个循环生成, 背景表复制前景表并改写一个字符, 避免每个实例化各自展开 256 次常量求值
+			inline constexpr auto palette_fg = [] {
+				std::array<std::array<char, 16>, 256> table{};
+				for (int i = 0; i < 256; ++i) {
+					auto& e = table[i];
+					int pos = 0;
+					for (char c : { '\x1b', '[', '3', '8', ';', '5', ';' }) e[pos++] = c;
+					pos += detail::int_to_chars(i, e.data() + pos);
+					e[pos] = 'm';
+				}
+				return table;
+			}();
+
+			inline constexpr auto palette_bg = [] {
+				auto table = palette_fg;
+				for (auto& e : table) e[2] = '4';
+				return table;
+			}();
+
+			// 指向 256 色表项的句柄: 只保存下标, to_view() 直接引用静态表, 不复制转义序列
+			// 逐单元格渲染时用 Color8<t>::ref(i) 代替构造 Color8
+			template <target t>
+			struct Color8Ref {
+				static constexpr std::size_t max_size = 11;
+				uint8_t index;
+
+				[[nodiscard]] constexpr std::string_view to_view() const noexcept {
+					const auto& e = (t == target::foreground ? palette_fg : palette_bg)[index];
+					return { e.data(), std::size_t(9 + (index >= 10) + (index >= 100)) }; // "\x1b[38;5;" + 数字 + 'm'
+				}
+
+				[[nodiscard]] constexpr uint8_t palette_index() const noexcept { return index; }
+			};
+
+			// 8bit color
+			template <target t, int N = 16>
+			class Color8 : public AnsiLiteral<N> {
+				static_assert(N >= 13, "Color8 needs room for \"\\x1b[38;5;255m\" plus its NUL terminator");
+
+				static constexpr const auto& palette = t == target::foreground ? palette_fg : palette_bg;
+
+				[[nodiscard]] static constexpr std::array<char, N> entry(uint8_t i) noexcept {
+					if constexpr (N == 16) {
+						return palette[i];
+					}
+					else {
+						std::array<char, N> e{};
+						for (int k = 0; k < 16 && k < N; ++k) e[k] = palette[i][k];
+						return e;
+					}
+				}
+
+			public:
+				constexpr Color8(uint8_t i) : AnsiLiteral<N>(entry(i)) {}
+
+				// 256 色下标, 从转义文本读取
+				[[nodiscard]] constexpr uint8_t palette_index() const noexcept {
+					return detail::color_params<1>(this->to_view())[0];
+				}
+
+				static constexpr Color8 at(uint8_t i) {
+					return Color8{ i };
+				}
+
+				// 不复制转义序列的句柄, 见 Color8Ref
+				static constexpr Color8Ref<t> ref(uint8_t i) noexcept {
+					return { i };
+				}
+			};
+
+            // 24bit true color
+			template <target t, int N = 32>
+			class Color24 : public AnsiLiteral<N> {
+				[[nodiscard]] static constexpr auto gen_ansi(uint8_t red, uint8_t green, uint8_t blue) noexcept {
+					return AnsiLiteral<N>(detail::make_escape('[', 'm', [&](auto& buf, int& pos) {
+						pos += detail::int_to_chars(static_cast<int>(t), buf.data() + pos); // 38 or 48
+						buf[pos++] = ';'; buf[pos++] = '2'; buf[pos++] = ';';
+						pos += detail::int_to_chars(red, buf.data() + pos);
+						buf[pos++] = ';';
+						pos += detail::int_to_chars(green, buf.data() + pos);
+						buf[pos++] = ';';
+						pos += detail::int_to_chars(blue, buf.data() + pos);
+						}));
+				}
+
+			public:
+				constexpr Color24(uint8_t red, uint8_t green, uint8_t blue) noexcept
+					: AnsiLiteral<N>(gen_ansi(red, green, blue)) {
+				}
+
+				// 24 位色分量, 从转义文本读取
+				[[nodiscard]] constexpr detail::rgb rgb() const noexcept {
+					auto [red, green, blue] = detail::color_params<3>(this->to_view());
+					return { red, green, blue };
+				}
+
+				// compile-time ctor
+				template <size_t L> requires(L == 8 || L == 5)
+				consteval Color24(const char(&hex)[L]) // "#RRGGBB\0"=8 "#RGB\0"=5
+					: Color24(parse(hex, L - 1)) {
+				}
+
+				// runtime ctor
+				explicit Color24(std::string_view hex)
+					: Color24(parse(hex.data(), hex.size())) {
+				}
+
+				// evaluated at both compile-time and runtime
+				static constexpr Color24 parse(const char* str, size_t len) {
+					assert(str[0] == '#' && "Hex color must start with '#'");
+
+					auto hex_digit = [](char c) noexcept {
+						if ('0' <= c && c <= '9') return (c - '0');
+						if ('a' <= c && c <= 'f') return (10 + (c - 'a'));
+						if ('A' <= c && c <= 'F') return (10 + (c - 'A'));
+						return 0;
+						};
+
+					if (len == 7) { // "#RRGGBB"
+						return {
+							static_cast<uint8_t>(hex_digit(str[1]) * 16 + hex_digit(str[2])),
+							static_cast<uint8_t>(hex_digit(str[3]) * 16 + hex_digit(str[4])),
+							static_cast<uint8_t>(hex_digit(str[5]) * 16 + hex_digit(str[6]))
+						};
+					}
+					else if (len == 4) { // "#RGB"
+						return {
+							static_cast<uint8_t>(hex_digit(str[1]) * 17),
+							static_cast<uint8_t>(hex_digit(str[2]) * 17),
+							static_cast<uint8_t>(hex_digit(str[3]) * 17)
+						};
+					}
+					else {
+						assert(false && "Color hex must be #RGB or #RRGGBB");
+						return { 0, 0, 0 };
+					}
+				}
+			};
+
+            using foreground4 = Color4<target::foreground>;
+		    using background4 = Color4<target::background>;
+            using foreground8 = Color8<target::foreground>;
+            using background8 = Color8<target::background>;
+
+			using foreground24 = Color24<target::foreground>;
+			using background24 = Color24<target::background>;
+
+			// 颜色对象只保存转义文本, 逐单元格复制的代价与数组大小相同
+			static_assert(sizeof(foreground8) == 16 && sizeof(foreground24) == 32);
+
+			consteval foreground24 operator""_fg(const char* str, size_t len) { return foreground24::parse(str, len); }
+			consteval background24 operator""_bg(const char* str, size_t len) { return background24::parse(str, len); }
+
+			namespace style {
+				inline constexpr sgr::Code bold     { 1 };
+				inline constexpr sgr::Code faint    { 2 };
+				inline constexpr sgr::Code italic   { 3 };
+				inline constexpr sgr::Code underline{ 4 };
+				inline constexpr sgr::Code blink    { 5 };
+				inline constexpr sgr::Code reverse  { 7 };
+				inline constexpr sgr::Code hidden   { 8 };
+				inline constexpr sgr::Code strike   { 9 };
+			}
+
+			inline constexpr Code reset{ 0 };
+
+			// 按属性取消, 只恢复对应部分而不影响其他状态 (reset 会同时清除前景/背景/全部样式)
+			namespace cancel {
+				inline constexpr sgr::Code intensity{ 22 }; // 取消粗体与淡色
+				inline constexpr sgr::Code italic   { 23 };
+				inline constexpr sgr::Code underline{ 24 };
+				inline constexpr sgr::Code blink    { 25 };
+				inline constexpr sgr::Code reverse  { 27 };
+				inline constexpr sgr::Code hidden   { 28 };
+				inline constexpr sgr::Code strike   { 29 };
+				inline constexpr sgr::Code fg       { 39 }; // 缺省前景色
+				inline constexpr sgr::Code bg       { 49 }; // 缺省背景色
+			}
+        }
+
+		inline constexpr AnsiLiteral<8> clear{ gen_ansi<8>(2, 'J') }; // "\x1b[2J"
+		// TODO  
+		// "\x1b[row;colH"
+		// "\x1bc" reset term
+	}
+
+	// Operating System Command
+	namespace osc {
+
+		template <int N = 128>
+		class Title : public AnsiLiteral<N> {
+			[[nodiscard]] constexpr static auto gen_ansi(std::string_view t) noexcept {
+				return AnsiLiteral<N>(detail::make_escape<N>(']', '\x07', [&](auto& buf, int& pos) {
+					buf[pos++] = '2'; buf[pos++] = ';';
+					for (size_t i = 0; i < t.size(); i++)
+						buf[pos++] = t[i];
+					}));
+			}
+		public:
+			// compile-time ctor
+			template <size_t L> requires (L < N - 4)
+				explicit consteval Title(const char(&txt)[L])
+				: AnsiLiteral<N>(gen_ansi(txt)) {
+			}
+			// runtime ctor
+			explicit Title(std::string_view txt)
+				: AnsiLiteral<N>(gen_ansi(txt)) {
+			}
+		};
+
+	}
+
+	// 编译期拼接的文本: constexpr auto label = fg4::red + "FAIL" + reset;
+	// colored 含转义序列, plain 为去除转义序列后的文本, 二者均在编译期生成, 输出时整段一次写出
+	template <std::size_t N, std::size_t P = N>
+	struct AnsiText {
+		std::array<char, N> colored{};
+		std::array<char, P> plain{};
+		std::size_t colored_len = 0;
+		std::size_t plain_len = 0;
+
+		constexpr std::string_view colored_view() const noexcept { return { colored.data(), colored_len }; }
+		constexpr std::string_view plain_view() const noexcept { return { plain.data(), plain_len }; }
+		constexpr std::string_view view(bool emit) const noexcept { return emit ? colored_view() : plain_view(); }
+	};
+
+	namespace detail {
+
+		template <class T>
+		struct is_ansi_text : std::false_type {};
+		template <std::size_t N, std::size_t P>
+		struct is_ansi_text<AnsiText<N, P>> : std::true_type {};
+
+		// 拼接的操作数: AnsiText / 转义对象 / 字符串字面量
+		template <class T>
+		concept text_operand = is_ansi_text<T>::value || ansi_object<T>
+			|| (std::is_array_v<T> && std::is_same_v<std::remove_extent_t<T>, char>);
+
+		template <text_operand T>
+		consteval auto to_text(const T& x) {
+			if constexpr (is_ansi_text<T>::value) {
+				return x;
+			}
+			else if constexpr (std::is_array_v<T>) {
+				AnsiText<std::extent_v<T> - 1> t;
+				for (std::size_t i = 0; i + 1 < std::extent_v<T> && x[i] != '\0'; ++i)
+					t.colored[t.colored_len++] = t.plain[t.plain_len++] = x[i];
+				return t;
+			}
+			else {
+				// AnsiLiteral 按其数组大小, 其他转义对象 (如 Color8Ref) 提供 max_size
+				constexpr std::size_t cap = [] {
+					if constexpr (requires { sizeof(T::value); }) return sizeof(T::value);
+					else return T::max_size;
+				}();
+				auto v = x.to_view();
+				AnsiText<cap, 0> t;
+				for (char c : v) t.colored[t.colored_len++] = c;
+				return t;
+			}
+		}
+	} // namespace detail
+
+	template <class L, class R>
+		requires detail::text_operand<L> && detail::text_operand<R> && (!std::is_array_v<L> || !std::is_array_v<R>)
+	consteval auto operator+(const L& l, const R& r) {
+		auto a = detail::to_text(l);
+		auto b = detail::to_text(r);
+		AnsiText<a.colored.size() + b.colored.size(), a.plain.size() + b.plain.size()> t;
+		for (char c : a.colored_view()) t.colored[t.colored_len++] = c;
+		for (char c : b.colored_view()) t.colored[t.colored_len++] = c;
+		for (char c : a.plain_view()) t.plain[t.plain_len++] = c;
+		for (char c : b.plain_view()) t.plain[t.plain_len++] = c;
+		return t;
+	}
+
+	// 收缩为精确大小: constexpr auto& label = exact<fg4::red + "FAIL" + reset>;
+	template <auto Text>
+		requires detail::is_ansi_text<std::remove_cv_t<decltype(Text)>>::value
+	inline constexpr auto exact = [] {
+		AnsiText<Text.colored_len, Text.plain_len> t;
+		for (char c : Text.colored_view()) t.colored[t.colored_len++] = c;
+		for (char c : Text.plain_view()) t.plain[t.plain_len++] = c;
+		return t;
+	}();
+
+	// 不经 std::ostream 的输出: 文件描述符走 writev, FILE* 走 fwrite
+	// 输出策略按目标判定一次 (文件描述符的 isatty 结果按 fd 缓存, refresh_is_tty() 时清空)
+
+	// (转义序列, 文本) 片段, 任一部分可为空; 策略关闭时只输出文本
+	struct part {
+		std::string_view escape;
+		std::string_view text;
+	};
+
+	inline bool emit(int fd, std::span<const part> parts) {
+		const bool on = tty::emit_ansi(fd);
+		std::string_view bufs[64];
+		std::size_t n = 0;
+		for (const part& p : parts) {
+			if (!p.escape.empty()) stats::sequence(stats::of(fd), on, p.escape.size());
+			stats::text(stats::of(fd), p.text.size());
+			if (on && !p.escape.empty()) bufs[n++] = p.escape;
+			if (!p.text.empty()) bufs[n++] = p.text;
+			if (n >= std::size(bufs) - 1) {
+				if (!detail::write_fd(fd, bufs, n)) return false;
+				n = 0;
+			}
+		}
+		return detail::write_fd(fd, bufs, n);
+	}
+
+	inline bool emit(int fd, std::initializer_list<part> parts) {
+		return emit(fd, std::span<const part>{ parts.begin(), parts.size() });
+	}
+
+	template <std::size_t N, std::size_t P>
+	inline bool emit(int fd, const AnsiText<N, P>& text) {
+		const bool on = tty::emit_ansi(fd);
+		stats::colored_text(stats::of(fd), on, text.colored_view(), text.plain_len);
+		auto v = text.view(on);
+		return detail::write_fd(fd, &v, 1);
+	}
+
+	template <std::size_t N, std::size_t P>
+	inline bool emit(std::FILE* f, const AnsiText<N, P>& text) {
+		const bool on = tty::emit_ansi(f);
+		stats::colored_text(stats::of(f), on, text.colored_view(), text.plain_len);
+		auto v = text.view(on);
+		return std::fwrite(v.data(), 1, v.size(), f) == v.size();
+	}
+
+	template <ansi_object AnsiObjectT>
+	inline bool emit(int fd, const AnsiObjectT& ao) {
+		auto v = ao.to_view();
+		const bool on = tty::emit_ansi(fd);
+		stats::sequence(stats::of(fd), on, v.size());
+		if (!on) return true;
+		return detail::write_fd(fd, &v, 1);
+	}
+
+	inline bool emit(std::FILE* f, std::span<const part> parts) {
+		const bool on = tty::emit_ansi(f);
+		for (const part& p : parts) {
+			if (!p.escape.empty()) stats::sequence(stats::of(f), on, p.escape.size());
+			stats::text(stats::of(f), p.text.size());
+			if (on && std::fwrite(p.escape.data(), 1, p.escape.size(), f) != p.escape.size()) return false;
+			if (std::fwrite(p.text.data(), 1, p.text.size(), f) != p.text.size()) return false;
+		}
+		return true;
+	}
+
+	inline bool emit(std::FILE* f, std::initializer_list<part> parts) {
+		return emit(f, std::span<const part>{ parts.begin(), parts.size() });
+	}
+
+	template <ansi_object AnsiObjectT>
+	inline bool emit(std::FILE* f, const AnsiObjectT& ao) {
+		auto v = ao.to_view();
+		const bool on = tty::emit_ansi(f);
+		stats::sequence(stats::of(f), on, v.size());
+		if (!on) return true;
+		return std::fwrite(v.data(), 1, v.size(), f) == v.size();
+	}
+
+	namespace csi::sgr {
+
+		// 运行期样式值: 前景 / 背景 (种类 + 值) 与属性位集合打包在一个 uint64_t 中
+		//   位 0-23  前景值 (16 色下标 / 256 色下标 / 0xRRGGBB)   位 24-25 前景种类
+		//   位 26-49 背景值                                       位 50-51 背景种类
+		//   位 52-59 属性, 第 k 位对应 SGR 代码 attr_codes[k]
+		// encode() 写出一个 "\x1b[0;...m", 使终端从任意状态切换到恰好此样式
+		struct Style {
+			enum class kind : uint8_t { none, c16, c256, rgb }; // none 为终端缺省色
+			enum attr : uint8_t {
+				bold = 1 << 0, faint = 1 << 1, italic = 1 << 2, underline = 1 << 3,
+				blink = 1 << 4, reverse = 1 << 5, hidden = 1 << 6, strike = 1 << 7,
+			};
+			static constexpr uint8_t attr_codes[8] = { 1, 2, 3, 4, 5, 7, 8, 9 };
+
+			// "\x1b[0;1;2;3;4;5;7;8;9;38;2;255;255;255;48;2;255;255;255m"
+			static constexpr std::size_t max_encoded = 54;
+			// "\x1b[22;1;23;24;25;27;28;29;38;2;255;255;255;48;2;255;255;255m"
+			static constexpr std::size_t max_transition = 59;
+
+			uint64_t bits = 0;
+
+			[[nodiscard]] constexpr kind fg_kind() const noexcept { return kind((bits >> 24) & 3); }
+			[[nodiscard]] constexpr uint32_t fg_value() const noexcept { return uint32_t(bits & 0xFFFFFF); }
+			[[nodiscard]] constexpr kind bg_kind() const noexcept { return kind((bits >> 50) & 3); }
+			[[nodiscard]] constexpr uint32_t bg_value() const noexcept { return uint32_t((bits >> 26) & 0xFFFFFF); }
+			[[nodiscard]] constexpr uint8_t attrs() const noexcept { return uint8_t(bits >> 52); }
+			[[nodiscard]] constexpr bool has(attr a) const noexcept { return (attrs() & a) != 0; }
+
+			constexpr Style& fg(kind k, uint32_t v) noexcept { return set_color(0, k, v); }
+			constexpr Style& bg(kind k, uint32_t v) noexcept { return set_color(26, k, v); }
+			constexpr Style& fg16(uint8_t i) noexcept { assert(i < 16); return fg(kind::c16, i); }
+			constexpr Style& bg16(uint8_t i) noexcept { assert(i < 16); return bg(kind::c16, i); }
+			constexpr Style& fg256(uint8_t i) noexcept { return fg(kind::c256, i); }
+			constexpr Style& bg256(uint8_t i) noexcept { return bg(kind::c256, i); }
+			constexpr Style& fg_rgb(uint8_t r, uint8_t g, uint8_t b) noexcept { return fg(kind::rgb, uint32_t(r) << 16 | uint32_t(g) << 8 | b); }
+			constexpr Style& bg_rgb(uint8_t r, uint8_t g, uint8_t b) noexcept { return bg(kind::rgb, uint32_t(r) << 16 | uint32_t(g) << 8 | b); }
+
+			// 取自颜色对象: Color8 / Color8Ref 按 256 色, Color24 按 24 位色
+			template <class C> requires requires(const C& c) { c.palette_index(); } || requires(const C& c) { c.rgb(); }
+			constexpr Style& fg(const C& c) noexcept {
+				if constexpr (requires { c.palette_index(); }) return fg256(c.palette_index());
+				else { auto v = c.rgb(); return fg_rgb(v.r, v.g, v.b); }
+			}
+			template <class C> requires requires(const C& c) { c.palette_index(); } || requires(const C& c) { c.rgb(); }
+			constexpr Style& bg(const C& c) noexcept {
+				if constexpr (requires { c.palette_index(); }) return bg256(c.palette_index());
+				else { auto v = c.rgb(); return bg_rgb(v.r, v.g, v.b); }
+			}
+
+			constexpr Style& set(uint8_t a) noexcept { bits |= uint64_t(a) << 52; return *this; }
+			constexpr Style& unset(uint8_t a) noexcept { bits &= ~(uint64_t(a) << 52); return *this; }
+
+			friend constexpr bool operator==(const Style&, const Style&) = default;
+
+			// 写入 out [out, out + max_encoded), 返回写入末尾
+			constexpr char* encode(char* out) const noexcept {
+				*out++ = '\x1b'; *out++ = '[';
+				*out++ = '0';
+				auto param = [&](int v) { *out++ = ';'; out += detail::int_to_chars(v, out); };
+				for (int k = 0; k < 8; ++k)
+					if (attrs() & (1 << k)) param(attr_codes[k]);
+				color_params(fg_kind(), fg_value(), 38, param);
+				color_params(bg_kind(), bg_value(), 48, param);
+				*out++ = 'm';
+				return out;
+			}
+
+			// 从 from 切换到 to: 在 选择性取消 (selective) 与 "0;" + 完整样式 (encode) 之间取较短者
+			// 写入 out [out, out + max_transition), 两者相同时不写入; 返回写入末尾
+			static constexpr char* transition(const Style& from, const Style& to, char* out) noexcept {
+				if (from == to) return out;
+				char full[max_encoded];
+				const auto full_len = to.encode(full) - full;
+				char* end = selective(from, to, out);
+				if (full_len < end - out) end = std::copy(full, full + full_len, out);
+				return end;
+			}
+
+			// 只输出变化的部分, 不使用 0
+			//   去除的属性用取消代码 (粗体/淡色共用 22, 其余为 代码 + 20, 见 cancel), 22 误伤的另一项随后补回
+			//   颜色变为缺省时用 39 / 49
+			static constexpr char* selective(const Style& from, const Style& to, char* out) noexcept {
+				if (from == to) return out;
+				char* const start = out;
+				*out++ = '\x1b'; *out++ = '[';
+				auto param = [&](int v) { if (out - start > 2) *out++ = ';'; out += detail::int_to_chars(v, out); };
+
+				const uint8_t removed = from.attrs() & ~to.attrs();
+				uint8_t added = to.attrs() & ~from.attrs();
+				if (removed & (bold | faint)) {
+					param(22);
+					added |= to.attrs() & (bold | faint);
+				}
+				for (int k = 2; k < 8; ++k)
+					if (removed & (1 << k)) param(attr_codes[k] + 20);
+				for (int k = 0; k < 8; ++k)
+					if (added & (1 << k)) param(attr_codes[k]);
+
+				if (from.fg_kind() != to.fg_kind() || from.fg_value() != to.fg_value()) {
+					if (to.fg_kind() == kind::none) param(39);
+					else color_params(to.fg_kind(), to.fg_value(), 38, param);
+				}
+				if (from.bg_kind() != to.bg_kind() || from.bg_value() != to.bg_value()) {
+					if (to.bg_kind() == kind::none) param(49);
+					else color_params(to.bg_kind(), to.bg_value(), 48, param);
+				}
+				*out++ = 'm';
+				return out;
+			}
+
+			// 编码结果, 可直接用于 operator<< / std::format / emit
+			struct encoded {
+				std::array<char, max_transition> buf;
+				uint8_t len;
+				[[nodiscard]] constexpr std::string_view to_view() const noexcept { return { buf.data(), len }; }
+			};
+
+			[[nodiscard]] constexpr encoded sgr() const noexcept {
+				encoded e{};
+				e.len = uint8_t(encode(e.buf.data()) - e.buf.data());
+				return e;
+			}
+
+			[[nodiscard]] static constexpr encoded sgr(const Style& from, const Style& to) noexcept {
+				encoded e{};
+				e.len = uint8_t(transition(from, to, e.buf.data()) - e.buf.data());
+				return e;
+			}
+
+			// 按种类写出一个颜色的参数; target 为 38 / 48
+			template <class Param>
+			static constexpr void color_params(kind k, uint32_t v, int target, Param&& param) {
+				switch (k) {
+				case kind::none: break;
+				case kind::c16: param(v < 8 ? target - 8 + int(v) : target + 52 + int(v) - 8); break;
+				case kind::c256: param(target); param(5); param(int(v)); break;
+				case kind::rgb: param(target); param(2); param(int(v >> 16)); param(int(v >> 8 & 0xFF)); param(int(v & 0xFF)); break;
+				}
+			}
+
+		private:
+			constexpr Style& set_color(int shift, kind k, uint32_t v) noexcept {
+				bits &= ~(uint64_t(0x3FFFFFF) << shift);
+				bits |= (uint64_t(k) << 24 | (v & 0xFFFFFF)) << shift;
+				return *this;
+			}
+		};
+
+		static_assert(sizeof(Style) == 8);
+	}
+
+}
+
+namespace std {
+	template <>
+	struct hash<ansi_escape::csi::sgr::Style> {
+		std::size_t operator()(const ansi_escape::csi::sgr::Style& s) const noexcept { return std::hash<uint64_t>{}(s.bits); }
+	};
+}
+
+// 兼容 ansi_color-1.0.0
+namespace ansi_color {
+
+    using namespace ansi_escape;
+    using namespace ansi_escape::csi;
+    using namespace ansi_escape::csi::sgr;
+
+    using fg4 = foreground4;
+    using bg4 = background4;
+    using fg8 = foreground8;
+    using bg8 = background8;
+
+	using fg24 = foreground24;
+	using bg24 = background24;
+
+}
+
@@ -0,0 +1,729 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright (c) 2025 TAO 12804985@qq.com
+ *
+ * @file    ansi_color_format.hpp
+ * @brief   std::format 集成: formatter / styled / markup / styled_template /
+ *          format_to_n / print 及按输出目标判定策略的 format 重载
+ * @version 1.2.0
+ * @date    2025-10-04
+ * 
+ * -----------------------------------------------------------------------------
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * -----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "ansi_color_core.hpp"
+#include "ansi_color_stream.hpp"
+
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+namespace ansi_escape {
+
+	namespace detail {
+
+		// 4 位颜色名称, 下标即颜色序号 (0-7 基础色, 8-15 亮色)
+		inline constexpr std::string_view color4_names[] = {
+			"black", "red", "green", "yellow", "blue", "magenta", "cyan", "white",
+			"bright_black", "bright_red", "bright_green", "bright_yellow",
+			"bright_blue", "bright_magenta", "bright_cyan", "bright_white",
+		};
+
+		// 样式名称, 下标即 SGR 代码 (6 未使用)
+		inline constexpr std::string_view style_names[] = {
+			"", "bold", "faint", "italic", "underline", "blink", "", "reverse", "hidden", "strike",
+		};
+
+		[[nodiscard]] constexpr int hex_value(char c) noexcept {
+			if ('0' <= c && c <= '9') return c - '0';
+			if ('a' <= c && c <= 'f') return 10 + (c - 'a');
+			if ('A' <= c && c <= 'F') return 10 + (c - 'A');
+			return -1;
+		}
+
+		// 合并多个 SGR 参数为单个 "\x1b[p1;p2;...m"
+		// 放不下的参数不写入并置 overflow, 由调用方报告错误; 始终为 close() 的 'm' 保留一个字节
+		template <std::size_t N = 64>
+		struct sgr_builder {
+			std::array<char, N> buf{ '\x1b', '[' };
+			int pos = 2;
+			bool overflow = false;
+
+			constexpr void param(int v) {
+				char digits[12]{};
+				const int n = int_to_chars(v, digits);
+				if (pos + (pos > 2) + n + 1 > int(N)) { overflow = true; return; }
+				if (pos > 2) buf[pos++] = ';';
+				for (int i = 0; i < n; ++i) buf[pos++] = digits[i];
+			}
+			constexpr bool empty() const noexcept { return pos == 2; }
+			constexpr void close() noexcept { buf[pos++] = 'm'; }
+			constexpr std::string_view view() const noexcept { return { buf.data(), std::size_t(pos) }; }
+		};
+
+		// 颜色说明: "#RGB" / "#RRGGBB" / "0".."255" (256 色) / 4 位颜色名称
+		// target 为 38 (前景) 或 48 (背景), 无法识别时返回 false
+		template <std::size_t N>
+		constexpr bool parse_color(std::string_view s, int target, sgr_builder<N>& out) {
+			if (s.size() > 1 && s[0] == '#') {
+				int v[6]{};
+				for (std::size_t i = 1; i < s.size() && i <= 6; ++i)
+					if ((v[i - 1] = hex_value(s[i])) < 0) return false;
+				out.param(target); out.param(2);
+				if (s.size() == 7) { out.param(v[0] * 16 + v[1]); out.param(v[2] * 16 + v[3]); out.param(v[4] * 16 + v[5]); }
+				else if (s.size() == 4) { out.param(v[0] * 17); out.param(v[1] * 17); out.param(v[2] * 17); }
+				else return false;
+				return true;
+			}
+			if (!s.empty() && s.size() <= 3 && '0' <= s[0] && s[0] <= '9') {
+				int v = 0;
+				for (char c : s) {
+					if (c < '0' || c > '9') return false;
+					v = v * 10 + (c - '0');
+				}
+				if (v > 255) return false;
+				out.param(target); out.param(5); out.param(v);
+				return true;
+			}
+			for (int i = 0; i < 16; ++i) {
+				if (s == color4_names[i]) {
+					out.param(i < 8 ? target - 8 + i : target + 52 + i - 8);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// 编译期字符串, 用作模板实参
+		template <std::size_t N>
+		struct fixed_string {
+			char value[N]{};
+
+			consteval fixed_string(const char(&str)[N]) {
+				for (std::size_t i = 0; i < N; ++i) value[i] = str[i];
+			}
+			constexpr std::string_view view() const noexcept { return { value, N - 1 }; }
+		};
+
+		// 标记文本: "<red>{}</red>" / "<bold>" / "<fg=#f00>" / "<bg=bright_blue>" / "</>" / "<<" (字面 '<')
+		// Colored 为 false 时仅移除标记; out 为空时只计算长度
+		// 闭合标记只恢复被覆盖的部分: 前景恢复外层前景或 39, 背景恢复外层背景或 49, 样式使用 22-29 取消
+		template <bool Colored>
+		constexpr std::size_t render_markup(std::string_view in, char* out) {
+			struct tag {
+				std::string_view name;
+				int kind = 0; // 0=fg, 1=bg, 2=style
+				int code = 0; // kind == 2 时的 SGR 代码
+				sgr_builder<32> sgr;
+			};
+			tag stack[16]{};
+			int depth = 0;
+			std::size_t n = 0;
+
+			auto put = [&](std::string_view s) {
+				if (out) for (char c : s) out[n++] = c;
+				else n += s.size();
+			};
+			auto emit = [&](sgr_builder<32> b) {
+				if constexpr (Colored) { b.close(); put(b.view()); }
+			};
+			auto restore = [&](const tag& closed) {
+				sgr_builder<32> b;
+				if (closed.kind == 2) {
+					for (int i = 0; i < depth; ++i)
+						if (stack[i].kind == 2 && stack[i].code == closed.code) return; // 外层仍然有效
+					bool is_intensity = closed.code == 1 || closed.code == 2;
+					b.param(is_intensity ? 22 : closed.code + 20);
+					for (int i = 0; is_intensity && i < depth; ++i)
+						if (stack[i].kind == 2 && (stack[i].code == 1 || stack[i].code == 2)) b.param(stack[i].code);
+					return emit(b);
+				}
+				for (int i = depth - 1; i >= 0; --i)
+					if (stack[i].kind == closed.kind) return emit(stack[i].sgr);
+				b.param(closed.kind == 0 ? 39 : 49);
+				emit(b);
+			};
+
+			for (std::size_t i = 0; i < in.size(); ) {
+				if (in[i] != '<') { put(in.substr(i, 1)); ++i; continue; }
+				if (i + 1 < in.size() && in[i + 1] == '<') { put("<"); i += 2; continue; }
+
+				std::size_t close = in.find('>', i);
+				if (close == std::string_view::npos) throw std::invalid_argument("ansi_escape markup: unterminated tag");
+				std::string_view name = in.substr(i + 1, close - i - 1);
+				i = close + 1;
+
+				if (name.starts_with('/')) {
+					name.remove_prefix(1);
+					if (depth == 0 || (!name.empty() && name != stack[depth - 1].name))
+						throw std::invalid_argument("ansi_escape markup: mismatched closing tag");
+					restore(stack[--depth]);
+					continue;
+				}
+
+				if (depth == 16) throw std::invalid_argument("ansi_escape markup: tags nested too deeply");
+				tag& t = stack[depth];
+				t = tag{};
+				t.name = name;
+				if (name.starts_with("bg=")) {
+					t.kind = 1;
+					if (!parse_color(name.substr(3), 48, t.sgr)) throw std::invalid_argument("ansi_escape markup: invalid color");
+				}
+				else if (!parse_color(name.starts_with("fg=") ? name.substr(3) : name, 38, t.sgr)) {
+					t.kind = 2;
+					while (t.code < 10 && (t.code == 0 || name != style_names[t.code])) ++t.code;
+					if (t.code == 10) throw std::invalid_argument("ansi_escape markup: unknown tag");
+					t.sgr.param(t.code);
+				}
+				emit(t.sgr);
+				++depth;
+			}
+			if (depth != 0) throw std::invalid_argument("ansi_escape markup: unclosed tag");
+			return n;
+		}
+
+		template <fixed_string S, bool Colored>
+		consteval auto markup_buffer() {
+			std::array<char, render_markup<Colored>(S.view(), nullptr) + 1> buf{};
+			render_markup<Colored>(S.view(), buf.data());
+			return buf;
+		}
+	} // namespace detail
+
+	template <class AnsiObjectT, class CharT = char>
+	struct formatter {
+		char mode = 'a'; // f=force, n=never, a=auto_
+		constexpr auto parse(std::basic_format_parse_context<CharT>& ctx) {
+			auto it = ctx.begin(), end = ctx.end();
+			if (it != end && (*it == 'f' || *it == 'n' || *it == 'a')) mode = static_cast<char>(*it++);
+			return it;
+		}
+		bool enabled() const {
+			switch (mode) {
+			case 'n': // never
+				return false;
+			case 'f': // force
+				return true;
+			case 'a': // auto (explicit or default)
+			default:
+				return tty::emit_ansi();
+			}
+		}
+		template <class FormatContext>
+		auto format(const AnsiObjectT& ao, FormatContext& ctx) const {
+			auto out = ctx.out();
+			const bool on = enabled();
+			stats::sequence(stats::current(), on, ao.to_view().size());
+			if (!on) return out;
+			for (auto c : ao.to_view()) *out++ = static_cast<CharT>(static_cast<std::make_unsigned_t<decltype(c)>>(c));
+			return out;
+		}
+	};
+
+	// 颜色对象的格式说明: [f|n|a][tc|256|16|hex|rgb]
+	//   tc / 256 / 16  按指定色深输出, 降级经 detail 中的查找表完成
+	//   hex / rgb      文本 "#RRGGBB" / "rgb(R,G,B)", 用于配置导出, 不受输出策略影响
+	template <csi::sgr::target t, class ColorT>
+	struct color_formatter : formatter<ColorT> {
+		enum class depth { native, tc, c256, c16, hex, rgb } d = depth::native;
+
+		constexpr auto parse(std::format_parse_context& ctx) {
+			auto it = formatter<ColorT>::parse(ctx), end = ctx.end();
+			auto rest = std::string_view{ it, end };
+			rest = rest.substr(0, rest.find('}'));
+			constexpr std::pair<std::string_view, depth> names[] = {
+				{ "tc", depth::tc }, { "256", depth::c256 }, { "16", depth::c16 }, { "hex", depth::hex }, { "rgb", depth::rgb },
+			};
+			for (auto [name, value] : names)
+				if (rest == name) { d = value; return it + name.size(); }
+			if (!rest.empty()) throw std::format_error("ansi_escape: invalid color depth specifier");
+			return it;
+		}
+
+		auto format(const ColorT& c, std::format_context& ctx) const {
+			auto out = ctx.out();
+			detail::rgb rgb{};
+			uint8_t index = 0;
+			if constexpr (requires { c.palette_index(); }) { index = c.palette_index(); rgb = detail::palette_rgb[index]; }
+			else { rgb = c.rgb(); }
+
+			if (d == depth::hex) return std::format_to(out, "#{:02X}{:02X}{:02X}", rgb.r, rgb.g, rgb.b);
+			if (d == depth::rgb) return std::format_to(out, "rgb({},{},{})", rgb.r, rgb.g, rgb.b);
+			const bool on = this->enabled();
+			if (!on) { stats::suppressed(stats::current()); return out; }
+
+			auto put = [&](std::string_view v) { stats::escape(stats::current(), v.size()); return std::copy(v.begin(), v.end(), out); };
+			if constexpr (requires { c.palette_index(); }) {
+				if (d == depth::tc) return put(csi::sgr::Color24<t>(rgb.r, rgb.g, rgb.b).to_view());
+			}
+			else {
+				if (d == depth::c256 || d == depth::c16) index = detail::rgb_to_256(rgb);
+				if (d == depth::c256) return put(csi::sgr::Color8<t>::ref(index).to_view());
+			}
+			if (d == depth::c16) return put(color16[detail::palette_to_16[index]].to_view());
+			return put(c.to_view());
+		}
+
+	private:
+		static constexpr auto color16 = []<size_t... Is>(std::index_sequence<Is...>) {
+			constexpr int base = static_cast<int>(t) - 8;
+			return std::array{ AnsiLiteral<8>(csi::gen_ansi<8>(Is < 8 ? base + int(Is) : base + 60 + int(Is) - 8, 'm'))... };
+		}(std::make_index_sequence<16>{});
+	};
+
+	// 带样式的值: std::format("{:fg=#f00;bold}", styled(v))
+	// 格式说明为 ';' 分隔的样式列表, '|' 之后为值本身的格式说明, 如 "{:n;fg=red|>8}"
+	// 值之后只取消设置过的部分 (39 / 49 / 22-29), 外层的其他样式 (如表格行的背景色) 保持不变
+	//   f / n / a             输出策略, 同 formatter
+	//   fg=COLOR / bg=COLOR   前景/背景色, COLOR 见 detail::parse_color
+	//   bold / italic / ...   样式名称, 见 detail::style_names
+	template <class T>
+	struct styled {
+		const T& value;
+	};
+
+	template <class T>
+	styled(const T&) -> styled<T>;
+
+	template <class T>
+	struct styled_formatter : formatter<styled<T>> {
+		detail::sgr_builder<> prefix;
+		detail::sgr_builder<> suffix;
+		std::formatter<T> inner;
+
+		constexpr auto parse(std::format_parse_context& ctx) {
+			auto it = ctx.begin(), end = ctx.end();
+			int cancels = 0;
+			while (it != end && *it != '}' && *it != '|') {
+				auto first = it;
+				while (it != end && *it != ';' && *it != '}' && *it != '|') ++it;
+				std::string_view tok{ first, it };
+				if (it != end && *it == ';') ++it;
+
+				if (tok.empty()) continue;
+				if (tok == "f" || tok == "n" || tok == "a") { this->mode = tok[0]; continue; }
+				if (tok.starts_with("fg=") && detail::parse_color(tok.substr(3), 38, prefix)) { cancels |= 1 << 10; continue; }
+				if (tok.starts_with("bg=") && detail::parse_color(tok.substr(3), 48, prefix)) { cancels |= 1 << 11; continue; }
+
+				int code = 1;
+				while (code < 10 && tok != detail::style_names[code]) ++code;
+				if (code == 10) throw std::format_error("ansi_escape::styled: invalid style specifier");
+				prefix.param(code);
+				cancels |= 1 << (code == 2 ? 1 : code); // 粗体与淡色共用 22
+			}
+			if (!prefix.empty()) {
+				prefix.close();
+				// 下标为样式代码 (1-9), 10 / 11 为前景 / 背景
+				constexpr int codes[] = { 0, 22, 0, 23, 24, 25, 0, 27, 28, 29, 39, 49 };
+				for (int i = 1; i < 12; ++i)
+					if (cancels & (1 << i)) suffix.param(codes[i]);
+				suffix.close();
+			}
+			if (prefix.overflow || suffix.overflow) throw std::format_error("ansi_escape::styled: style specifier too long");
+			if (it != end && *it == '|') ++it;
+			ctx.advance_to(it);
+			return inner.parse(ctx);
+		}
+
+		auto format(const styled<T>& s, std::format_context& ctx) const {
+			const bool on = !prefix.empty() && this->enabled();
+			if (!prefix.empty()) {
+				stats::sequence(stats::current(), on, prefix.view().size());
+				stats::sequence(stats::current(), on, suffix.view().size());
+			}
+			if (on) {
+				auto seq = prefix.view();
+				ctx.advance_to(std::copy(seq.begin(), seq.end(), ctx.out()));
+			}
+			auto out = inner.format(s.value, ctx);
+			if (on) {
+				auto r = suffix.view();
+				out = std::copy(r.begin(), r.end(), out);
+			}
+			return out;
+		}
+	};
+
+	// 编译期标记模板: "<red>{}</red>"_markup(42)
+	// 着色与纯文本两种格式串均在编译期生成, 调用时按 tty 策略选择其一
+	template <detail::fixed_string S>
+	struct markup {
+		static constexpr auto colored_buf = detail::markup_buffer<S, true>();
+		static constexpr auto plain_buf = detail::markup_buffer<S, false>();
+		static constexpr std::string_view colored{ colored_buf.data(), colored_buf.size() - 1 };
+		static constexpr std::string_view plain{ plain_buf.data(), plain_buf.size() - 1 };
+		static constexpr auto escapes = static_cast<std::size_t>(std::count(colored.begin(), colored.end(), '\x1b'));
+
+		template <class... Args>
+		std::string operator()(Args&&... args) const {
+			const bool on = tty::emit_ansi();
+			count(on);
+			if (on)
+				return std::format(std::format_string<Args...>(colored), std::forward<Args>(args)...);
+			return std::format(std::format_string<Args...>(plain), std::forward<Args>(args)...);
+		}
+
+		template <class OutputIt, class... Args>
+		OutputIt format_to(OutputIt out, Args&&... args) const {
+			const bool on = tty::emit_ansi();
+			count(on);
+			if (on)
+				return std::format_to(out, std::format_string<Args...>(colored), std::forward<Args>(args)...);
+			return std::format_to(out, std::format_string<Args...>(plain), std::forward<Args>(args)...);
+		}
+
+	private:
+		static void count(bool on) noexcept {
+			if (on) stats::escape(stats::current(), colored.size() - plain.size(), escapes);
+			else stats::suppressed(stats::current(), escapes);
+		}
+	};
+
+	template <detail::fixed_string S>
+	consteval markup<S> operator""_markup() { return {}; }
+
+	namespace detail {
+
+		// styled_template 的一次渲染: 其 formatter 在同一个 format_context 中写出各参数及其间的文本片段,
+		// 参数直接由构造时解析好的 formatter 格式化, 每次渲染只经过一次 "{}"
+		template <class Template, class Values>
+		struct template_call {
+			const Template& tpl;
+			bool emit;
+			Values values;
+		};
+	} // namespace detail
+
+	// 预编译的带样式模板: 构造时按 markup 语法解析一次 (如 "<red>{}</red>: {:>8}"),
+	// 文本与转义序列预先切分到一块连续内存, 参数的格式说明也预先解析;
+	// 渲染只是依次复制文本片段与格式化参数, 仅在开始时判定一次输出策略
+	template <class... Args>
+	class styled_template {
+		struct slice { std::size_t offset, length; };
+		using slices = std::array<slice, sizeof...(Args) + 1>; // 第 i 个片段之后是第 i 个参数
+
+	public:
+		explicit styled_template(std::string_view text) {
+			std::size_t colored_len = 0;
+			try {
+				colored_len = detail::render_markup<true>(text, nullptr);
+			}
+			catch (const std::invalid_argument& e) {
+				throw std::format_error(e.what()); // 与其余格式错误一致, 统一为 std::format_error
+			}
+			std::string colored(colored_len, '\0');
+			std::string plain(detail::render_markup<false>(text, nullptr), '\0');
+			detail::render_markup<true>(text, colored.data());
+			detail::render_markup<false>(text, plain.data());
+			escapes_ = static_cast<std::size_t>(std::count(colored.begin(), colored.end(), '\x1b'));
+			escape_bytes_ = colored.size() - plain.size();
+			colored_ = split(colored, true);
+			plain_ = split(plain, false);
+		}
+
+		template <class OutputIt>
+		OutputIt render_to(OutputIt out, const Args&... args) const {
+			return render_to(out, tty::emit_ansi(), args...);
+		}
+
+		template <class OutputIt>
+		OutputIt render_to(OutputIt out, bool emit, const Args&... args) const {
+			if (emit) stats::escape(stats::current(), escape_bytes_, escapes_);
+			else stats::suppressed(stats::current(), escapes_);
+			// 首尾片段直接复制, 各参数及其间的片段在一次 format_to 中写出
+			const slices& s = emit ? colored_ : plain_;
+			out = std::copy_n(arena_.data() + s.front().offset, s.front().length, std::move(out));
+			if constexpr (sizeof...(Args) > 0)
+				out = std::format_to(std::move(out), "{}", call{ *this, emit, std::forward_as_tuple(args...) });
+			return std::copy_n(arena_.data() + s.back().offset, s.back().length, std::move(out));
+		}
+
+		std::string render(const Args&... args) const {
+			std::string out;
+			render_to(std::back_inserter(out), args...);
+			return out;
+		}
+
+	private:
+		using call = detail::template_call<styled_template, std::tuple<const Args&...>>;
+		friend struct std::formatter<call>;
+
+		std::string arena_;
+		slices colored_{}, plain_{};
+		std::size_t escapes_ = 0, escape_bytes_ = 0;
+		std::tuple<std::formatter<Args>...> formatters_;
+
+		std::format_context::iterator write(const call& c, std::format_context& ctx) const {
+			// 写出 参数 0, 片段 1, 参数 1, ..., 参数 n-1; 首尾片段由 render_to 直接复制
+			const slices& s = c.emit ? colored_ : plain_;
+			auto out = ctx.out();
+			[&]<std::size_t... I>(std::index_sequence<I...>) {
+				((I > 0 ? void(ctx.advance_to(std::copy_n(arena_.data() + s[I].offset, s[I].length, out))) : void(),
+					out = std::get<I>(formatters_).format(std::get<I>(c.values), ctx)), ...);
+			}(std::index_sequence_for<Args...>{});
+			return out;
+		}
+
+		// 切分格式串: 文本片段 (已处理 "{{" / "}}") 追加到 arena_, 参数格式说明交给对应的 formatter
+		slices split(std::string_view fmt, bool parse_specs) {
+			slices result{};
+			std::size_t field = 0, start = arena_.size();
+			for (std::size_t i = 0; i < fmt.size(); ++i) {
+				char c = fmt[i];
+				if ((c == '{' || c == '}') && i + 1 < fmt.size() && fmt[i + 1] == c) { arena_ += c; ++i; continue; }
+				if (c == '}') throw std::format_error("ansi_escape::styled_template: unmatched '}'");
+				if (c != '{') { arena_ += c; continue; }
+
+				std::size_t close = fmt.find('}', i);
+				if (close == fmt.npos || field == sizeof...(Args))
+					throw std::format_error("ansi_escape::styled_template: argument count mismatch");
+				std::string_view spec = fmt.substr(i + 1, close - i - 1);
+				if (!spec.empty() && spec[0] != ':')
+					throw std::format_error("ansi_escape::styled_template: only automatic argument indexing is supported");
+				std::size_t from = spec.empty() ? i + 1 : i + 2;
+				if (parse_specs) parse_spec(field, fmt.substr(from, close + 1 - from));
+
+				result[field++] = { start, arena_.size() - start };
+				start = arena_.size();
+				i = close;
+			}
+			if (field != sizeof...(Args))
+				throw std::format_error("ansi_escape::styled_template: argument count mismatch");
+			result.back() = { start, arena_.size() - start };
+			return result;
+		}
+
+		// spec 为 ':' 之后直到并包含 '}' 的部分
+		void parse_spec(std::size_t field, std::string_view spec) {
+			[&]<std::size_t... I>(std::index_sequence<I...>) {
+				((I == field ? void(parse_one(std::get<I>(formatters_), spec)) : void()), ...);
+			}(std::index_sequence_for<Args...>{});
+		}
+
+		template <class Formatter>
+		static void parse_one(Formatter& f, std::string_view spec) {
+			std::format_parse_context ctx{ spec };
+			auto it = f.parse(ctx);
+			if (it == ctx.end() || *it != '}')
+				throw std::format_error("ansi_escape::styled_template: invalid format specifier");
+		}
+	};
+
+	namespace detail {
+
+		// 截断收尾: 丢弃末尾不完整的转义序列, 若最后一个 SGR 不是 reset, 则在 n 字节内补写 "\x1b[0m"
+		inline char* close_truncated(char* buf, std::size_t n) noexcept {
+			constexpr std::string_view reset = "\x1b[0m";
+			std::size_t end = n;
+			for (;;) {
+				// 不完整的序列: CSI 缺少终止字节, OSC 缺少 BEL / ST
+				for (std::size_t e = end; e-- > 0; ) {
+					if (buf[e] != '\x1b') continue;
+					std::string_view seq{ buf + e, end - e };
+					bool complete = seq.size() >= 2 && seq[1] != '[' && seq[1] != ']';
+					if (seq.size() >= 2 && seq[1] == '[')
+						complete = seq.find_first_of("@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~", 2) != seq.npos;
+					if (seq.size() >= 2 && seq[1] == ']')
+						complete = seq.find('\x07') != seq.npos || seq.find("\x1b\\", 1) != seq.npos;
+					if (!complete) end = e;
+					break;
+				}
+
+				// 最后一个 SGR ("\x1b[...m") 决定当前是否仍有样式
+				bool open = false;
+				for (std::size_t e = end; e-- > 0; ) {
+					if (buf[e] != '\x1b' || e + 1 >= end || buf[e + 1] != '[') continue;
+					std::string_view seq{ buf + e + 2, end - e - 2 };
+					std::size_t fin = seq.find_first_not_of("0123456789;:");
+					if (fin == seq.npos || seq[fin] != 'm') continue;
+					std::string_view params = seq.substr(0, fin);
+					open = !(params.empty() || params == "0");
+					break;
+				}
+
+				if (!open) return buf + end;
+				if (end + reset.size() <= n) return std::copy(reset.begin(), reset.end(), buf + end);
+				if (n < reset.size()) return buf; // 放不下 reset, 宁可不输出
+				end = n - reset.size();
+			}
+		}
+	} // namespace detail
+
+	struct format_to_n_result {
+		char* out;        // 写入末尾
+		std::size_t size; // 未截断时的完整长度
+		bool truncated;
+	};
+
+	// 有界格式化: 只写入调用方缓冲区 [buf, buf + n), 不分配内存
+	// 截断时不会留下半个转义序列, 也不会让终端停留在着色状态
+	template <class... Args>
+	format_to_n_result format_to_n(char* buf, std::size_t n, std::format_string<Args...> fmt, Args&&... args) {
+		auto r = std::format_to_n(buf, static_cast<std::ptrdiff_t>(n), fmt, std::forward<Args>(args)...);
+		auto size = static_cast<std::size_t>(r.size);
+		if (size <= n) return { r.out, size, false };
+		return { detail::close_truncated(buf, n), size, true };
+	}
+
+	template <std::size_t N, class... Args>
+	format_to_n_result format_to_n(char(&buf)[N], std::format_string<Args...> fmt, Args&&... args) {
+		return ansi_escape::format_to_n(buf, N, fmt, std::forward<Args>(args)...);
+	}
+
+	namespace detail {
+
+		// 先写入栈上缓冲, 溢出后整体转入 std::string
+		class spill_buffer {
+			char stack_[512];
+			std::size_t size_ = 0;
+			std::string heap_;
+
+		public:
+			struct iterator {
+				using difference_type = std::ptrdiff_t;
+				spill_buffer* buf;
+				iterator& operator*() noexcept { return *this; }
+				iterator& operator++() noexcept { return *this; }
+				iterator operator++(int) noexcept { return *this; }
+				iterator& operator=(char c) { buf->push_back(c); return *this; }
+			};
+
+			void push_back(char c) {
+				if (heap_.empty() && size_ < sizeof(stack_)) { stack_[size_++] = c; return; }
+				if (heap_.empty()) heap_.assign(stack_, size_);
+				heap_.push_back(c);
+			}
+			iterator out() noexcept { return { this }; }
+			std::string_view view() const noexcept { return heap_.empty() ? std::string_view{ stack_, size_ } : heap_; }
+		};
+
+		inline void vprint(std::FILE* f, std::string_view fmt, std::format_args args) {
+			tty::scoped_target target{ tty::emit_ansi(f) };
+			stats::scoped_call call{ stats::of(f) };
+			spill_buffer buf;
+			std::vformat_to(buf.out(), fmt, args);
+			auto text = buf.view();
+			call.finish(text.size());
+			std::fwrite(text.data(), 1, text.size(), f);
+		}
+
+		// 记录写出字节数的输出迭代器, 启用计数时包裹 format / format_to 的目标, 以推算文本字节
+		template <class OutputIt>
+		struct counting_iterator {
+			using difference_type = std::ptrdiff_t;
+			OutputIt it;
+			std::size_t count = 0;
+			counting_iterator& operator*() noexcept { return *this; }
+			counting_iterator& operator++() noexcept { return *this; }
+			counting_iterator& operator++(int) noexcept { return *this; }
+			counting_iterator& operator=(char c) { *it = c; ++it; ++count; return *this; }
+		};
+
+		template <class OutputIt>
+		OutputIt vformat_counted(OutputIt out, stats::sink s, std::string_view fmt, std::format_args args) {
+			if constexpr (stats::enabled) {
+				stats::scoped_call call{ s };
+				auto r = std::vformat_to(counting_iterator<OutputIt>{ std::move(out) }, fmt, args);
+				call.finish(r.count);
+				return std::move(r.it);
+			}
+			else {
+				(void)s;
+				return std::vformat_to(std::move(out), fmt, args);
+			}
+		}
+	} // namespace detail
+
+	// 输出到 FILE*: 按目标文件一次性判定 ANSI 策略, 整条消息一次 fwrite
+	template <class... Args>
+	void print(std::FILE* f, std::format_string<Args...> fmt, Args&&... args) {
+		detail::vprint(f, fmt.get(), std::make_format_args(args...));
+	}
+
+	template <class... Args>
+	void print(std::format_string<Args...> fmt, Args&&... args) {
+		detail::vprint(stdout, fmt.get(), std::make_format_args(args...));
+	}
+
+	// 输出到 std::ostream: 按该流的策略一次性判定, {} / {:a} 跟随此结果, 直接写入流缓冲
+	template <class... Args>
+	std::ostream& format(std::ostream& os, std::format_string<Args...> fmt, Args&&... args) {
+		tty::scoped_target target{ tty::emit_ansi(os) };
+		detail::vformat_counted(std::ostreambuf_iterator<char>(os), stats::of(os), fmt.get(), std::make_format_args(args...));
+		return os;
+	}
+
+	// 输出到任意迭代器: 目标视为非终端, 按 p 判定 (force / never, auto_ 等同 never)
+	template <class OutputIt, class... Args>
+	OutputIt format_to(OutputIt out, tty::policy p, std::format_string<Args...> fmt, Args&&... args) {
+		tty::scoped_target target{ tty::emit_policy(p, false) };
+		return detail::vformat_counted(std::move(out), stats::sink::other, fmt.get(), std::make_format_args(args...));
+	}
+
+}
+
+namespace std {
+
+	template <typename AnsiObjectT, class CharT>
+		requires ansi_escape::ansi_object<AnsiObjectT, CharT> || ansi_escape::ansi_object<AnsiObjectT>
+	struct formatter<AnsiObjectT, CharT> : ansi_escape::formatter<AnsiObjectT, CharT> { };
+
+	template <class T>
+	struct formatter<ansi_escape::styled<T>> : ansi_escape::styled_formatter<T> { };
+
+	template <std::size_t N, std::size_t P>
+	struct formatter<ansi_escape::AnsiText<N, P>> : ansi_escape::formatter<ansi_escape::AnsiText<N, P>> {
+		// 只计入转义部分; 文本部分与其余字面文本一样, 由 scoped_call::finish 计为文本字节
+		auto format(const ansi_escape::AnsiText<N, P>& text, std::format_context& ctx) const {
+			const bool on = this->enabled();
+			if constexpr (ansi_escape::stats::enabled) {
+				const auto colored = text.colored_view();
+				const auto n = static_cast<std::size_t>(std::count(colored.begin(), colored.end(), '\x1b'));
+				if (on) ansi_escape::stats::escape(ansi_escape::stats::current(), colored.size() - text.plain_len, n);
+				else ansi_escape::stats::suppressed(ansi_escape::stats::current(), n);
+			}
+			auto v = text.view(on);
+			return std::copy(v.begin(), v.end(), ctx.out());
+		}
+	};
+
+	template <class Template, class Values>
+	struct formatter<ansi_escape::detail::template_call<Template, Values>> {
+		constexpr auto parse(std::format_parse_context& ctx) { return ctx.begin(); }
+		auto format(const ansi_escape::detail::template_call<Template, Values>& c, std::format_context& ctx) const {
+			return c.tpl.write(c, ctx);
+		}
+	};
+
+	template <ansi_escape::csi::sgr::target t, int N>
+	struct formatter<ansi_escape::csi::sgr::Color8<t, N>> : ansi_escape::color_formatter<t, ansi_escape::csi::sgr::Color8<t, N>> { };
+
+	template <ansi_escape::csi::sgr::target t>
+	struct formatter<ansi_escape::csi::sgr::Color8Ref<t>> : ansi_escape::color_formatter<t, ansi_escape::csi::sgr::Color8Ref<t>> { };
+
+	template <ansi_escape::csi::sgr::target t, int N>
+	struct formatter<ansi_escape::csi::sgr::Color24<t, N>> : ansi_escape::color_formatter<t, ansi_escape::csi::sgr::Color24<t, N>> { };
+
+}
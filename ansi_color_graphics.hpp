@@ -0,0 +1,945 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright (c) 2025 TAO 12804985@qq.com
+ *
+ * @file    ansi_color_graphics.hpp
+ * @brief   终端图形: 半块字符图像渲染, 盲文点阵画布, 迷你折线与条形图, sixel (DCS) 与 kitty 图形协议 (APC) 图像编码
+ * @version 1.2.0
+ * @date    2025-10-04
+ * 
+ * -----------------------------------------------------------------------------
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * -----------------------------------------------------------------------------
+ */
+
+
+#pragma once
+
+#include "ansi_color_core.hpp"
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ansi_escape {
+
+	namespace graphics {
+
+		// 输出色深: 24 位色, 或经 detail 中的查找表降级到 256 / 16 色
+		enum class color_depth { truecolor, c256, c16 };
+
+		// RGB888 图像, 每行 stride 字节
+		struct image_view {
+			const uint8_t* rgb = nullptr;
+			int width = 0, height = 0;
+			std::size_t stride = 0;
+
+			[[nodiscard]] constexpr detail::rgb at(int x, int y) const noexcept {
+				const uint8_t* p = rgb + std::size_t(y) * stride + std::size_t(x) * 3;
+				return { p[0], p[1], p[2] };
+			}
+		};
+
+		// RGBA8888 图像, 每行 stride 字节; 目前只用于 kitty 图形协议 (f=32)
+		struct rgba_view {
+			const uint8_t* rgba = nullptr;
+			int width = 0, height = 0;
+			std::size_t stride = 0;
+		};
+
+		namespace detail {
+
+			using ansi_escape::detail::rgb;
+
+			// 0-255 的十进制文本, [3] 为长度; 写出时总是复制 4 字节, 再按长度前进
+			inline constexpr auto u8_digits = [] {
+				std::array<std::array<char, 4>, 256> table{};
+				for (int i = 0; i < 256; ++i) table[i][3] = char(ansi_escape::detail::int_to_chars(i, table[i].data()));
+				return table;
+			}();
+
+			inline char* put_u8(char* out, uint8_t v) noexcept {
+				std::memcpy(out, u8_digits[v].data(), 4);
+				return out + u8_digits[v][3];
+			}
+
+			inline char* put(char* out, std::string_view s) noexcept {
+				std::memcpy(out, s.data(), s.size());
+				return out + s.size();
+			}
+
+			// 无符号 32 位十进制文本, 最多 10 字节
+			inline char* put_u32(char* out, uint32_t v) noexcept {
+				char digits[10];
+				int n = 0;
+				do { digits[n++] = char('0' + v % 10); v /= 10; } while (v);
+				while (n) *out++ = digits[--n];
+				return out;
+			}
+
+			// 按色深量化后的颜色, 用于判断是否与上一单元格相同: 24 位色为 0xRRGGBB, 256 / 16 色为下标
+			template <color_depth D>
+			inline uint32_t quantize(rgb c) noexcept {
+				if constexpr (D == color_depth::truecolor) return uint32_t(c.r) << 16 | uint32_t(c.g) << 8 | c.b;
+				else if constexpr (D == color_depth::c256) return ansi_escape::detail::rgb_to_256(c);
+				else return ansi_escape::detail::palette_to_16[ansi_escape::detail::rgb_to_256(c)];
+			}
+
+			// 写出一个已量化颜色的 SGR 参数 (不含分隔符); target 为 38 / 48
+			template <color_depth D>
+			inline char* color_params(char* out, uint32_t q, int target) noexcept {
+				if constexpr (D == color_depth::truecolor) {
+					out = put(out, target == 38 ? "38;2;" : "48;2;");
+					out = put_u8(out, uint8_t(q >> 16)); *out++ = ';';
+					out = put_u8(out, uint8_t(q >> 8)); *out++ = ';';
+					return put_u8(out, uint8_t(q));
+				}
+				else if constexpr (D == color_depth::c256) {
+					out = put(out, target == 38 ? "38;5;" : "48;5;");
+					return put_u8(out, uint8_t(q));
+				}
+				else {
+					return put_u8(out, uint8_t(q < 8 ? target - 8 + int(q) : target + 52 + int(q) - 8));
+				}
+			}
+		} // namespace detail
+
+		// 半块字符渲染: 每个单元格输出 "▀", 前景色取上方像素, 背景色取下方像素, 一行单元格对应两行像素
+		// 前景 / 背景与前一单元格相同时不再输出, 两者都变化时合并为一个 CSI; 上下像素相同时输出空格, 只需背景色
+		// 每行以 "\x1b[0m\n" 结束, 各行互不依赖, 可分别编码后直接拼接
+		namespace halfblock {
+
+			inline constexpr std::string_view glyph = "\xe2\x96\x80"; // U+2580 ▀
+
+			// 一行单元格编码后的最大字节数: "\x1b[38;2;255;255;255;48;2;255;255;255m" + "▀", 行尾 "\x1b[0m\n"
+			[[nodiscard]] constexpr std::size_t row_capacity(int width) noexcept {
+				return std::size_t(width) * (36 + glyph.size()) + 5 + 4; // 4 字节为 put_u8 的写出余量
+			}
+
+			[[nodiscard]] constexpr int rows(const image_view& img) noexcept { return (img.height + 1) / 2; }
+
+			// 编码第 row 行单元格 (像素行 2*row 与 2*row+1) 到 out, 返回写入末尾; 图像高度为奇数时最后一行的背景为缺省色
+			template <color_depth D>
+			inline char* encode_row(const image_view& img, int row, char* out) noexcept {
+				using detail::quantize;
+				constexpr uint32_t none = 0xFFFFFFFF;
+				uint32_t cur_fg = none, cur_bg = none;
+				// 先取出到局部变量: 经 char* 写出会被视为可能修改 img
+				const int width = img.width;
+				const uint8_t* top_row = img.rgb + std::size_t(row * 2) * img.stride;
+				const uint8_t* bottom_row = row * 2 + 1 < img.height ? top_row + img.stride : nullptr;
+
+				// 降级查表前先与上一个像素比较, 相同颜色连续出现时省去查表
+				uint32_t last_top = none, last_bottom = none, q_top = 0, q_bottom = 0;
+				auto pixel = [](const uint8_t* p, uint32_t& last, uint32_t& q) {
+					const uint32_t c = uint32_t(p[0]) << 16 | uint32_t(p[1]) << 8 | p[2];
+					if constexpr (D == color_depth::truecolor) return c;
+					if (c != last) { last = c; q = quantize<D>({ p[0], p[1], p[2] }); }
+					return q;
+				};
+
+				for (int x = 0; x < width; ++x) {
+					const uint32_t top = pixel(top_row + x * 3, last_top, q_top);
+					const uint32_t bottom = bottom_row ? pixel(bottom_row + x * 3, last_bottom, q_bottom) : none;
+					// 上下相同: 空格 + 背景色, 前景色保持不变
+					const bool solid = top == bottom;
+					const bool set_fg = !solid && top != cur_fg;
+					const bool set_bg = solid ? top != cur_bg : bottom != none && bottom != cur_bg;
+					const bool clear_bg = !solid && bottom == none && cur_bg != none;
+
+					if (set_fg || set_bg || clear_bg) {
+						*out++ = '\x1b'; *out++ = '[';
+						if (set_fg) { out = detail::color_params<D>(out, top, 38); cur_fg = top; }
+						if (set_bg || clear_bg) {
+							if (set_fg) *out++ = ';';
+							if (clear_bg) { out = detail::put(out, "49"); cur_bg = none; }
+							else { out = detail::color_params<D>(out, solid ? top : bottom, 48); cur_bg = solid ? top : bottom; }
+						}
+						*out++ = 'm';
+					}
+					if (solid) *out++ = ' ';
+					else out = detail::put(out, glyph);
+				}
+				return detail::put(out, "\x1b[0m\n");
+			}
+
+			inline char* encode_row(const image_view& img, int row, color_depth depth, char* out) noexcept {
+				switch (depth) {
+				case color_depth::c256: return encode_row<color_depth::c256>(img, row, out);
+				case color_depth::c16: return encode_row<color_depth::c16>(img, row, out);
+				default: return encode_row<color_depth::truecolor>(img, row, out);
+				}
+			}
+
+			// 并行编码器: 按行分段由多个线程编码到各自的缓冲区; 缓冲区在多帧之间复用, 避免每帧重新分配并触发缺页
+			class renderer {
+				struct band {
+					std::unique_ptr<char[]> buf;
+					std::size_t capacity = 0, size = 0;
+				};
+				std::vector<band> bands_;
+
+			public:
+				// threads 为 0 时取硬件并发数
+				void encode(const image_view& img, color_depth depth, unsigned threads = 0) {
+					const int total = rows(img);
+					if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+					threads = std::min<unsigned>(threads, unsigned(std::max(total, 1)));
+					bands_.resize(threads);
+
+					auto encode_band = [&](unsigned t) {
+						const int first = int(std::size_t(total) * t / threads), last = int(std::size_t(total) * (t + 1) / threads);
+						band& b = bands_[t];
+						const std::size_t need = row_capacity(img.width) * std::size_t(last - first);
+						if (b.capacity < need) { b.buf.reset(new char[need]); b.capacity = need; } // 不做零初始化
+						char* out = b.buf.get();
+						for (int r = first; r < last; ++r) out = encode_row(img, r, depth, out);
+						b.size = std::size_t(out - b.buf.get());
+					};
+
+					std::vector<std::thread> workers;
+					for (unsigned t = 1; t < threads; ++t) workers.emplace_back(encode_band, t);
+					encode_band(0);
+					for (auto& w : workers) w.join();
+				}
+
+				// 上一次 encode() 的结果, 按顺序交给 write(std::string_view), 如写入文件描述符, 不拼接成整串
+				template <class Write>
+				void write_to(Write&& write) const {
+					for (const auto& b : bands_) write(std::string_view{ b.buf.get(), b.size });
+				}
+
+				template <class Write>
+				void render_to(const image_view& img, color_depth depth, unsigned threads, Write&& write) {
+					encode(img, depth, threads);
+					write_to(write);
+				}
+
+				std::string render(const image_view& img, color_depth depth = color_depth::truecolor, unsigned threads = 0) {
+					encode(img, depth, threads);
+					std::size_t size = 0;
+					for (const auto& b : bands_) size += b.size;
+					std::string result;
+					result.reserve(size);
+					write_to([&](std::string_view v) { result.append(v); });
+					return result;
+				}
+			};
+
+			inline std::string render(const image_view& img, color_depth depth = color_depth::truecolor, unsigned threads = 0) {
+				return renderer{}.render(img, depth, threads);
+			}
+		} // namespace halfblock
+
+		// 盲文点阵画布: 单元格为 U+2800 + 8 位点位图, 分辨率为单元格数的 2×4 倍
+		// 点以每单元格一字节的位图保存; 每个单元格一个前景色, 由最后绘制的点决定; 输出时经 Style::transition 只写出颜色变化
+		//   braille::canvas c(80, 20);
+		//   c.series(samples, 0.0, 100.0, fg8::ref(45)); // samples 为 std::vector<double>
+		//   std::string frame = c.render();
+		namespace braille {
+
+			// 单元格内 [y][x] 对应的点位: 左列自上而下为点 1 2 3 7, 右列为点 4 5 6 8
+			inline constexpr uint8_t dot_bits[4][2] = { { 0x01, 0x08 }, { 0x02, 0x10 }, { 0x04, 0x20 }, { 0x40, 0x80 } };
+
+			class canvas {
+			public:
+				using Style = csi::sgr::Style;
+
+				// 每个单元格输出的最大字节数: 颜色切换 + 3 字节 UTF-8; 每行另有复位与换行
+				static constexpr std::size_t cell_capacity = Style::max_transition + 3;
+
+				canvas(int cols, int rows)
+					: cols_(cols), rows_(rows), dots_(std::size_t(cols) * rows), colors_(std::size_t(cols) * rows) {
+					assert(cols >= 0 && rows >= 0);
+				}
+
+				[[nodiscard]] int cols() const noexcept { return cols_; }
+				[[nodiscard]] int rows() const noexcept { return rows_; }
+				[[nodiscard]] int width() const noexcept { return cols_ * 2; }
+				[[nodiscard]] int height() const noexcept { return rows_ * 4; }
+
+				void clear() noexcept {
+					std::fill(dots_.begin(), dots_.end(), uint8_t(0));
+					std::fill(colors_.begin(), colors_.end(), Style{});
+				}
+
+				// color 为 Style, 或 Color8 / Color8Ref / Color24 (取为前景色); 超出画布的点被忽略
+				template <class C = Style>
+				void set(int x, int y, const C& color = {}) noexcept {
+					if (unsigned(x) >= unsigned(width()) || unsigned(y) >= unsigned(height())) return;
+					const std::size_t cell = std::size_t(y >> 2) * cols_ + (x >> 1);
+					dots_[cell] |= dot_bits[y & 3][x & 1];
+					colors_[cell] = pen(color);
+				}
+
+				void unset(int x, int y) noexcept {
+					if (unsigned(x) >= unsigned(width()) || unsigned(y) >= unsigned(height())) return;
+					dots_[std::size_t(y >> 2) * cols_ + (x >> 1)] &= uint8_t(~dot_bits[y & 3][x & 1]);
+				}
+
+				[[nodiscard]] bool test(int x, int y) const noexcept {
+					if (unsigned(x) >= unsigned(width()) || unsigned(y) >= unsigned(height())) return false;
+					return (dots_[std::size_t(y >> 2) * cols_ + (x >> 1)] & dot_bits[y & 3][x & 1]) != 0;
+				}
+
+				// Bresenham 直线, 包含两个端点
+				template <class C = Style>
+				void line(int x0, int y0, int x1, int y1, const C& color = {}) noexcept {
+					const Style s = pen(color);
+					const int dx = std::abs(x1 - x0), dy = -std::abs(y1 - y0);
+					const int sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1;
+					for (int err = dx + dy;;) {
+						set(x0, y0, s);
+						if (x0 == x1 && y0 == y1) break;
+						const int e2 = 2 * err;
+						if (e2 >= dy) { err += dy; x0 += sx; }
+						if (e2 <= dx) { err += dx; y0 += sy; }
+					}
+				}
+
+				// 折线图: [lo, hi] 映射为从底部到顶部; 值不多于列数时第 i 个值画在 x = i, 相邻的点以直线相连
+				// 值多于列数 (width()) 时按列分桶: 每列画出桶内最小值到最大值的竖线, 并与前一列的最后一个值相连, 不丢弃数据
+				// T 由 lo / hi 推导, values 可直接传入 std::vector<T> 或 std::span<T>
+				template <class T, class C = Style>
+				void series(std::span<const std::type_identity_t<T>> values, T lo, T hi, const C& color = {}) noexcept {
+					const Style s = pen(color);
+					const int bottom = std::max(height() - 1, 0);
+					const double scale = hi != lo ? double(bottom) / (double(hi) - double(lo)) : 0.0;
+					auto to_y = [&](T v) {
+						const double y = double(bottom) - (double(v) - double(lo)) * scale + 0.5;
+						if (!(y > 0)) return 0; // 包括 NaN
+						return y >= double(bottom) ? bottom : int(y);
+					};
+					const std::size_t n = values.size(), w = std::size_t(width());
+					if (n == 0 || w == 0) return;
+
+					if (n <= w) {
+						int prev = to_y(values[0]);
+						set(0, prev, s);
+						for (std::size_t i = 1; i < n; ++i) {
+							const int y = to_y(values[i]);
+							line(int(i) - 1, prev, int(i), y, s);
+							prev = y;
+						}
+						return;
+					}
+
+					int prev_last = 0;
+					for (std::size_t x = 0; x < w; ++x) {
+						const std::size_t first = n * x / w, last = n * (x + 1) / w; // n > w, 每个桶非空
+						const int y_first = to_y(values[first]);
+						int y_min = y_first, y_max = y_first, y_last = y_first;
+						for (std::size_t i = first + 1; i < last; ++i) {
+							y_last = to_y(values[i]);
+							y_min = std::min(y_min, y_last);
+							y_max = std::max(y_max, y_last);
+						}
+						if (x > 0) line(int(x) - 1, prev_last, int(x), y_first, s);
+						line(int(x), y_min, int(x), y_max, s);
+						prev_last = y_last;
+					}
+				}
+
+				[[nodiscard]] std::size_t capacity() const noexcept {
+					return (std::size_t(cols_) * cell_capacity + Style::max_transition + 1) * std::size_t(rows_);
+				}
+
+				// 写入 out [out, out + capacity()), 返回写入末尾; 空单元格输出空格, 每行以恢复缺省样式与 '\n' 结束
+				char* render(char* out) const noexcept {
+					const uint8_t* dots = dots_.data();
+					const Style* colors = colors_.data();
+					for (int r = 0; r < rows_; ++r) {
+						Style cur{};
+						for (int c = 0; c < cols_; ++c, ++dots, ++colors) {
+							const uint8_t m = *dots;
+							if (!m) { *out++ = ' '; continue; }
+							if (*colors != cur) { out = switch_to(cur, *colors, out); cur = *colors; }
+							*out++ = '\xe2';
+							*out++ = char(0xA0 | m >> 6);
+							*out++ = char(0x80 | (m & 0x3F));
+						}
+						out = Style::transition(cur, Style{}, out);
+						*out++ = '\n';
+					}
+					return out;
+				}
+
+				[[nodiscard]] std::string render() const {
+					std::string result(capacity(), '\0');
+					result.resize(std::size_t(render(result.data()) - result.data()));
+					return result;
+				}
+
+			private:
+				int cols_, rows_;
+				std::vector<uint8_t> dots_;
+				std::vector<Style> colors_;
+
+				// 只有前景色的值不同 (常见于多条不同颜色的折线) 时直接查表写出 "\x1b[38;...m", 这也是 transition 会选择的最短形式
+				static char* switch_to(const Style& from, const Style& to, char* out) noexcept {
+					if ((from.bits ^ to.bits) >> 24) return Style::transition(from, to, out);
+					*out++ = '\x1b'; *out++ = '[';
+					switch (to.fg_kind()) {
+					case Style::kind::c16: out = detail::color_params<color_depth::c16>(out, to.fg_value(), 38); break;
+					case Style::kind::c256: out = detail::color_params<color_depth::c256>(out, to.fg_value(), 38); break;
+					default: out = detail::color_params<color_depth::truecolor>(out, to.fg_value(), 38); break;
+					}
+					*out++ = 'm';
+					return out;
+				}
+
+				template <class C>
+				static constexpr Style pen(const C& color) noexcept {
+					if constexpr (std::is_same_v<C, Style>) return color;
+					else return Style{}.fg(color);
+				}
+			};
+		} // namespace braille
+
+		// 数值到 [0, unit] 的定点比例: 每个值一次乘法, 之后的字形与颜色均按比例查表
+		template <class T>
+		class scale {
+			double lo_, factor_;
+		public:
+			static constexpr uint32_t unit = 1u << 16;
+
+			// [lo, hi] 映射为 [0, unit], 区间外的值取端点; lo == hi 时都映射为 0
+			constexpr scale(T lo, T hi) noexcept
+				: lo_(double(lo)), factor_(hi != lo ? double(unit) / (double(hi) - double(lo)) : 0.0) {}
+
+			[[nodiscard]] constexpr uint32_t operator()(T v) const noexcept {
+				const double f = (double(v) - lo_) * factor_;
+				if (!(f > 0)) return 0; // 包括 NaN
+				return f >= double(unit) ? unit : uint32_t(f);
+			}
+		};
+
+		// 渐变色表: 256 档前景色, 构造时按色深量化并编码好 SGR, 输出时只做复制
+		//   graphics::gradient heat({ { 0, 160, 0 }, { 255, 200, 0 }, { 220, 0, 0 } }, color_depth::c256);
+		class gradient {
+			// "\x1b[38;2;255;255;255m" 最长 19 字节, [23] 为长度
+			std::array<std::array<char, 24>, 256> seq_{};
+
+			template <color_depth D>
+			void build(std::initializer_list<detail::rgb> stops) noexcept {
+				const auto* s = stops.begin();
+				const int segments = int(stops.size()) - 1;
+				for (int i = 0; i < 256; ++i) {
+					detail::rgb c = s[0];
+					if (segments > 0) {
+						const int pos = i * segments, k = std::min(pos / 255, segments - 1), t = pos - k * 255; // 第 k 段, 段内 t / 255
+						auto mix = [&](uint8_t a, uint8_t b) { return uint8_t((a * (255 - t) + b * t + 127) / 255); };
+						c = { mix(s[k].r, s[k + 1].r), mix(s[k].g, s[k + 1].g), mix(s[k].b, s[k + 1].b) };
+					}
+					char buf[32];
+					char* out = detail::put(buf, "\x1b[");
+					out = detail::color_params<D>(out, detail::quantize<D>(c), 38);
+					*out++ = 'm';
+					std::memcpy(seq_[i].data(), buf, std::size_t(out - buf));
+					seq_[i][23] = char(out - buf);
+				}
+			}
+
+		public:
+			// stops 为等距的颜色节点, 至少一个
+			gradient(std::initializer_list<detail::rgb> stops, color_depth depth = color_depth::truecolor) noexcept {
+				assert(stops.size() > 0 && "gradient needs at least one color");
+				switch (depth) {
+				case color_depth::c256: build<color_depth::c256>(stops); break;
+				case color_depth::c16: build<color_depth::c16>(stops); break;
+				default: build<color_depth::truecolor>(stops); break;
+				}
+			}
+
+			static constexpr std::size_t max_size = 19;
+
+			[[nodiscard]] std::string_view operator[](uint8_t i) const noexcept { return { seq_[i].data(), std::size_t(seq_[i][23]) }; }
+
+			char* put(uint8_t i, char* out) const noexcept {
+				std::memcpy(out, seq_[i].data(), max_size);
+				return out + seq_[i][23];
+			}
+		};
+
+		// 迷你折线 "▁▂▃▄▅▆▇█": 每个值一个字符, 按比例分 8 级; 带渐变色时颜色也按级别取, 与前一字符同级时不再输出颜色
+		// 值的类型 T 由 scale<T> 推导, values 可直接传入 std::vector<T> 或 std::span<T>
+		namespace sparkline {
+
+			// U+2581 - U+2588, [3] 为补齐
+			inline constexpr std::array<std::array<char, 4>, 8> glyphs = { {
+				{ '\xe2', '\x96', '\x81' }, { '\xe2', '\x96', '\x82' }, { '\xe2', '\x96', '\x83' }, { '\xe2', '\x96', '\x84' },
+				{ '\xe2', '\x96', '\x85' }, { '\xe2', '\x96', '\x86' }, { '\xe2', '\x96', '\x87' }, { '\xe2', '\x96', '\x88' },
+			} };
+
+			// 级别 -> 渐变色档位
+			inline constexpr uint8_t level_color[8] = { 0, 36, 73, 109, 146, 182, 219, 255 };
+
+			[[nodiscard]] constexpr int level(uint32_t f) noexcept { return int(std::min<uint32_t>(f >> 13, 7)); }
+
+			// n 个值编码后的最大字节数; 带颜色时每个值另有一个颜色序列, 末尾 "\x1b[39m"
+			[[nodiscard]] constexpr std::size_t capacity(std::size_t n, bool colored = false) noexcept {
+				return colored ? n * (3 + gradient::max_size) + 5 + gradient::max_size : n * 3 + 1;
+			}
+
+			// 写入 out [out, out + capacity(values.size())), 返回写入末尾
+			template <class T>
+			inline char* render(std::span<const std::type_identity_t<T>> values, const scale<T>& s, char* out) noexcept {
+				for (const T& v : values) {
+					std::memcpy(out, glyphs[level(s(v))].data(), 4);
+					out += 3;
+				}
+				return out;
+			}
+
+			// 带渐变色, 写入 out [out, out + capacity(values.size(), true)); 结束时只恢复前景色 (39)
+			template <class T>
+			inline char* render(std::span<const std::type_identity_t<T>> values, const scale<T>& s, const gradient& g, char* out) noexcept {
+				if (values.empty()) return out;
+				int prev = -1;
+				for (const T& v : values) {
+					const int l = level(s(v));
+					if (l != prev) { out = g.put(level_color[l], out); prev = l; }
+					std::memcpy(out, glyphs[l].data(), 4);
+					out += 3;
+				}
+				return detail::put(out, "\x1b[39m");
+			}
+		} // namespace sparkline
+
+		// 水平条形图: 长度以 1/8 单元格为单位, 整格用 "█", 末格用 "▏" - "▉", 不足 width 时以空格补齐
+		namespace bar {
+
+			// 左侧 i/8 宽的块字符 (U+258F - U+2589), [0] 为空
+			inline constexpr std::array<std::array<char, 4>, 8> partial = { {
+				{}, { '\xe2', '\x96', '\x8f' }, { '\xe2', '\x96', '\x8e' }, { '\xe2', '\x96', '\x8d' },
+				{ '\xe2', '\x96', '\x8c' }, { '\xe2', '\x96', '\x8b' }, { '\xe2', '\x96', '\x8a' }, { '\xe2', '\x96', '\x89' },
+			} };
+			inline constexpr std::string_view full = "\xe2\x96\x88"; // U+2588 █
+
+			// 一条宽 width 的条形编码后的最大字节数 (含颜色与 "\x1b[39m"); rows() 每行另有 '\n'
+			// 以下各函数中 width 小于 0 时按 0 处理
+			[[nodiscard]] constexpr std::size_t capacity(int width, bool colored = false) noexcept {
+				return std::size_t(std::max(width, 0)) * 3 + 1 + (colored ? gradient::max_size + 5 : 0);
+			}
+
+			namespace detail {
+				inline char* cells(uint32_t f, int width, char* out) noexcept {
+					width = std::max(width, 0);
+					const uint32_t eighths = uint32_t((uint64_t(f) * uint32_t(width) * 8) >> 16);
+					const int cells = int(eighths >> 3), rest = int(eighths & 7);
+					for (int i = 0; i < cells; ++i) out = graphics::detail::put(out, full);
+					if (rest) { std::memcpy(out, partial[rest].data(), 4); out += 3; }
+					const int pad = std::max(width - cells - (rest != 0), 0);
+					std::memset(out, ' ', std::size_t(pad));
+					return out + pad;
+				}
+			}
+
+			// 写入 out [out, out + capacity(width)), 返回写入末尾
+			template <class T>
+			inline char* render(std::type_identity_t<T> value, const scale<T>& s, int width, char* out) noexcept {
+				return detail::cells(s(value), width, out);
+			}
+
+			// 颜色按值在渐变中的位置选取; 写入 out [out, out + capacity(width, true))
+			template <class T>
+			inline char* render(std::type_identity_t<T> value, const scale<T>& s, int width, const gradient& g, char* out) noexcept {
+				const uint32_t f = s(value);
+				out = g.put(uint8_t(std::min<uint32_t>(f >> 8, 255)), out);
+				out = detail::cells(f, width, out);
+				return graphics::detail::put(out, "\x1b[39m");
+			}
+
+			// 直方图: 每个值一行条形, 以 '\n' 结束; 写入 out [out, out + values.size() * (capacity(width, g != nullptr) + 1))
+			template <class T>
+			inline char* rows(std::span<const std::type_identity_t<T>> values, const scale<T>& s, int width, const gradient* g, char* out) noexcept {
+				for (const T& v : values) {
+					out = g ? render(v, s, width, *g, out) : render(v, s, width, out);
+					*out++ = '\n';
+				}
+				return out;
+			}
+		} // namespace bar
+	}
+
+	// Device Control String
+	namespace dcs {
+
+		inline constexpr std::string_view st = "\x1b\\";
+
+		// sixel 图像: 每个数据字符表示一列 6 个像素 ('?' + 位图), 一条 6 像素高的横带按颜色分多遍绘制
+		//   "\x1bPq" + "\"1;1;W;H" + 调色板 "#i;2;r;g;b" (百分比) + 各横带 + "\x1b\\"
+		// 横带内每种颜色输出 "#i" 与该颜色的一行数据, 以 "$" 回到行首, 横带之间以 "-" 换行; 重复 4 次以上的字符编码为 "!n<c>"
+		// 颜色寄存器即 xterm 256 色下标, 像素经 detail::rgb_to_256 量化, 只定义图像中用到的颜色
+		namespace sixel {
+
+			// 编码器: 量化结果与各线程的横带缓冲区在多帧之间复用
+			class renderer {
+				static constexpr int band_height = 6;
+				static constexpr int bands_per_task = 8; // 每个线程一次编码的横带数, 限制同时驻留的输出大小
+
+				struct worker {
+					std::vector<uint8_t> masks;          // [颜色][x] 的 6 位位图, 只有用到的区间非零, 输出后清零
+					std::array<int, 256> first{}, last{}; // 颜色在横带内出现的 x 范围, last < 0 表示未出现
+					std::vector<uint8_t> used;            // 横带内出现的颜色, 按首次出现的顺序
+					std::string out;
+				};
+
+				std::vector<uint8_t> index_; // 每像素的颜色寄存器
+				std::vector<worker> workers_;
+				int width_ = 0, height_ = 0;
+
+				static void put_uint(std::string& out, unsigned v) {
+					char buf[16];
+					out.append(buf, std::size_t(ansi_escape::detail::int_to_chars(int(v), buf)));
+				}
+
+				static void put_run(std::string& out, char c, int n) {
+					if (n > 3) { out += '!'; put_uint(out, unsigned(n)); out += c; }
+					else out.append(std::size_t(n), c);
+				}
+
+				// 量化第 [first, last) 行, 并记录用到的颜色
+				void quantize_rows(const graphics::image_view& img, int first, int last, std::array<bool, 256>& used) {
+					for (int y = first; y < last; ++y) {
+						const uint8_t* row = img.rgb + std::size_t(y) * img.stride;
+						uint8_t* idx = index_.data() + std::size_t(y) * width_;
+						uint32_t last_c = 0xFFFFFFFF;
+						uint8_t q = 0;
+						for (int x = 0; x < width_; ++x) {
+							const uint8_t* p = row + x * 3;
+							const uint32_t c = uint32_t(p[0]) << 16 | uint32_t(p[1]) << 8 | p[2];
+							if (c != last_c) { last_c = c; q = ansi_escape::detail::rgb_to_256({ p[0], p[1], p[2] }); used[q] = true; }
+							idx[x] = q;
+						}
+					}
+				}
+
+				// 编码从像素行 y0 开始的一条横带到 w.out (追加)
+				void encode_band(int y0, worker& w) const {
+					const int width = width_, rows = std::min(band_height, height_ - y0);
+					for (int r = 0; r < rows; ++r) {
+						const uint8_t* idx = index_.data() + std::size_t(y0 + r) * width;
+						const uint8_t bit = uint8_t(1u << r);
+						for (int x = 0; x < width; ++x) {
+							const uint8_t c = idx[x];
+							w.masks[std::size_t(c) * width + x] |= bit;
+							if (w.last[c] < 0) { w.used.push_back(c); w.first[c] = x; }
+							w.first[c] = std::min(w.first[c], x);
+							w.last[c] = std::max(w.last[c], x);
+						}
+					}
+
+					for (uint8_t c : w.used) {
+						w.out += '#';
+						put_uint(w.out, c);
+						uint8_t* m = w.masks.data() + std::size_t(c) * width;
+						const int end = w.last[c] + 1;
+						put_run(w.out, '?', w.first[c]); // 左侧未用到该颜色的部分
+						int x = w.first[c];
+						while (x < end) {
+							const uint8_t v = m[x];
+							int n = 1;
+							while (x + n < end && m[x + n] == v) ++n;
+							put_run(w.out, char('?' + v), n);
+							x += n;
+						}
+						std::memset(m + w.first[c], 0, std::size_t(end - w.first[c]));
+						w.last[c] = -1;
+						w.out += '$';
+					}
+					w.used.clear();
+					if (y0 + band_height < height_) w.out.back() = '-'; // 最后一遍的 "$" 换为 "-"
+				}
+
+			public:
+				// 编码 img 并依次交给 write(std::string_view); 横带由 threads 个线程并行编码 (0 为硬件并发数), 按顺序写出
+				template <class Write>
+				void render_to(const graphics::image_view& img, unsigned threads, Write&& write) {
+					width_ = img.width; height_ = img.height;
+					const int bands = (height_ + band_height - 1) / band_height;
+					if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+					threads = std::min<unsigned>(threads, unsigned(std::max(bands, 1)));
+					workers_.resize(threads);
+					index_.resize(std::size_t(width_) * height_);
+
+					auto parallel = [&](auto&& job) {
+						std::vector<std::thread> pool;
+						for (unsigned t = 1; t < threads; ++t) pool.emplace_back(job, t);
+						job(0u);
+						for (auto& th : pool) th.join();
+					};
+
+					// 量化, 并汇总用到的颜色
+					std::vector<std::array<bool, 256>> used(threads, std::array<bool, 256>{});
+					parallel([&](unsigned t) {
+						quantize_rows(img, int(std::size_t(height_) * t / threads), int(std::size_t(height_) * (t + 1) / threads), used[t]);
+					});
+
+					std::string head;
+					head += "\x1bPq\"1;1;";
+					put_uint(head, unsigned(width_)); head += ';';
+					put_uint(head, unsigned(height_));
+					for (int c = 0; c < 256; ++c) {
+						bool any = false;
+						for (const auto& u : used) any |= u[c];
+						if (!any) continue;
+						const auto& rgb = ansi_escape::detail::palette_rgb[c];
+						head += '#'; put_uint(head, unsigned(c));
+						head += ";2;"; put_uint(head, (rgb.r * 100u + 127) / 255);
+						head += ';'; put_uint(head, (rgb.g * 100u + 127) / 255);
+						head += ';'; put_uint(head, (rgb.b * 100u + 127) / 255);
+					}
+					write(std::string_view{ head });
+					if (width_ == 0 || height_ == 0) { write(st); return; } // 空图像没有横带
+
+					for (auto& w : workers_) {
+						if (w.masks.size() != std::size_t(width_) * 256) w.masks.assign(std::size_t(width_) * 256, 0);
+						w.last.fill(-1);
+					}
+
+					// 每轮由各线程编码连续的 bands_per_task 条横带, 轮末按顺序写出
+					const int per_round = int(threads) * bands_per_task;
+					for (int base = 0; base < bands; base += per_round) {
+						parallel([&](unsigned t) {
+							worker& w = workers_[t];
+							w.out.clear();
+							const int first = base + int(t) * bands_per_task;
+							const int last = std::min(first + bands_per_task, bands);
+							for (int b = first; b < last; ++b) encode_band(b * band_height, w);
+						});
+						for (const auto& w : workers_) if (!w.out.empty()) write(std::string_view{ w.out });
+					}
+					write(st);
+				}
+
+				std::string render(const graphics::image_view& img, unsigned threads = 0) {
+					std::string result;
+					render_to(img, threads, [&](std::string_view v) { result.append(v); });
+					return result;
+				}
+			};
+
+			inline std::string render(const graphics::image_view& img, unsigned threads = 0) {
+				return renderer{}.render(img, threads);
+			}
+		} // namespace sixel
+	}
+
+	// Application Program Command
+	namespace apc {
+
+		inline constexpr std::string_view st = "\x1b\\";
+
+		// kitty 图形协议: "\x1b_G<键=值,...>;<base64 数据>\x1b\\"
+		// 数据按 4096 字节 base64 分块, 第一块携带全部控制键, 其后各块只带 m (m=1 表示还有后续块, 最后一块 m=0)
+		// 指定图像编号时, 与上次传输内容相同的帧只输出放置命令 a=p, 不再重新传输像素
+		namespace kitty {
+
+			inline constexpr std::size_t chunk_size = 4096;             // 每块 base64 字节数, 协议上限
+			inline constexpr std::size_t chunk_raw = chunk_size / 4 * 3; // 每块对应的原始字节数
+
+			namespace detail {
+
+				inline constexpr std::string_view base64_alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+				// 12 位 -> 2 个 base64 字符, 每 3 字节只需两次查表
+				inline constexpr auto base64_pairs = [] {
+					std::array<std::array<char, 2>, 4096> table{};
+					for (int i = 0; i < 4096; ++i) table[i] = { base64_alphabet[i >> 6], base64_alphabet[i & 63] };
+					return table;
+				}();
+
+				inline char* put_group(char* out, uint32_t v) noexcept {
+					std::memcpy(out, base64_pairs[v >> 12].data(), 2);
+					std::memcpy(out + 2, base64_pairs[v & 0xFFF].data(), 2);
+					return out + 4;
+				}
+
+				// 按大端读出 6 字节, 即两个 24 位分组; 逐字节组合, 编译器会合并为一次 64 位读取加字节交换
+				inline uint64_t load48(const uint8_t* p) noexcept {
+					return uint64_t(p[0]) << 40 | uint64_t(p[1]) << 32 | uint64_t(p[2]) << 24 | uint64_t(p[3]) << 16 | uint64_t(p[4]) << 8 | p[5];
+				}
+
+				// base64 编码 n 字节到 out, 返回写入末尾; 主循环每次处理 12 字节, 末尾不足 3 字节时补 '='
+				inline char* base64(const uint8_t* in, std::size_t n, char* out) noexcept {
+					std::size_t i = 0;
+					for (; i + 12 <= n; i += 12) {
+						const uint64_t a = load48(in + i), b = load48(in + i + 6);
+						out = put_group(out, uint32_t(a >> 24));
+						out = put_group(out, uint32_t(a & 0xFFFFFF));
+						out = put_group(out, uint32_t(b >> 24));
+						out = put_group(out, uint32_t(b & 0xFFFFFF));
+					}
+					for (; i + 3 <= n; i += 3)
+						out = put_group(out, uint32_t(in[i]) << 16 | uint32_t(in[i + 1]) << 8 | in[i + 2]);
+					if (const std::size_t rest = n - i) {
+						const uint32_t v = uint32_t(in[i]) << 16 | (rest == 2 ? uint32_t(in[i + 1]) << 8 : 0);
+						put_group(out, v);
+						out[3] = '=';
+						if (rest == 1) out[2] = '=';
+						out += 4;
+					}
+					return out;
+				}
+
+				// 判断帧是否变化的 64 位散列, 按 8 字节处理
+				inline uint64_t hash(const uint8_t* p, std::size_t n, uint64_t h) noexcept {
+					constexpr uint64_t k = 0x9E3779B97F4A7C15ull;
+					std::size_t i = 0;
+					for (; i + 8 <= n; i += 8) {
+						uint64_t v;
+						std::memcpy(&v, p + i, 8);
+						h = (h ^ v) * k;
+						h ^= h >> 29;
+					}
+					for (; i < n; ++i) h = (h ^ p[i]) * k;
+					return h ^ (h >> 32);
+				}
+			} // namespace detail
+
+			// 编码器: 输出缓冲区与各图像编号最近一次传输内容的散列在多帧之间复用
+			class encoder {
+				static constexpr std::size_t chunks_per_write = 16; // 每写出一次包含的块数
+
+				struct uploaded { uint32_t id; uint64_t hash; };
+				std::vector<uploaded> uploaded_;
+				std::string buf_;
+				std::vector<uint8_t> staging_; // stride 大于行宽时, 先把一块数据复制到连续的缓冲区
+
+				template <class Write>
+				void transmit(const uint8_t* pixels, int width, int height, std::size_t stride, int bpp, uint32_t id, Write& write) {
+					const std::size_t row = std::size_t(width) * bpp, total = row * std::size_t(height);
+					const bool packed = stride == row;
+					if (!packed) staging_.resize(chunk_raw);
+
+					// 第 offset 字节起的 n 字节; 行间有间隙时逐行复制
+					auto source = [&](std::size_t offset, std::size_t n) -> const uint8_t* {
+						if (packed) return pixels + offset;
+						for (std::size_t done = 0; done < n;) {
+							const std::size_t y = (offset + done) / row, x = (offset + done) % row;
+							const std::size_t len = std::min(row - x, n - done);
+							std::memcpy(staging_.data() + done, pixels + y * stride + x, len);
+							done += len;
+						}
+						return staging_.data();
+					};
+
+					buf_.resize((chunks_per_write + 1) * (chunk_size + 96));
+					char* const begin = buf_.data();
+					char* out = begin;
+					std::size_t chunks = 0;
+					for (std::size_t offset = 0; offset < total || offset == 0; offset += chunk_raw) {
+						const std::size_t n = std::min(chunk_raw, total - offset);
+						const bool more = offset + n < total;
+						out = graphics::detail::put(out, "\x1b_G");
+						if (offset == 0) {
+							out = graphics::detail::put(out, bpp == 4 ? "a=T,f=32,s=" : "a=T,f=24,s=");
+							out += ansi_escape::detail::int_to_chars(width, out);
+							out = graphics::detail::put(out, ",v=");
+							out += ansi_escape::detail::int_to_chars(height, out);
+							if (id) {
+								out = graphics::detail::put(out, ",i=");
+								out = graphics::detail::put_u32(out, id);
+							}
+							out = graphics::detail::put(out, ",q=2,");
+						}
+						out = graphics::detail::put(out, more ? "m=1;" : "m=0;");
+						out = detail::base64(source(offset, n), n, out);
+						out = graphics::detail::put(out, st);
+						if (++chunks == chunks_per_write || !more) {
+							write(std::string_view{ begin, std::size_t(out - begin) });
+							out = begin;
+							chunks = 0;
+						}
+						if (!more) break;
+					}
+				}
+
+				template <class Write>
+				bool render_to(const uint8_t* pixels, int width, int height, std::size_t stride, int bpp, uint32_t id, Write& write) {
+					if (id == 0) {
+						transmit(pixels, width, height, stride, bpp, 0, write);
+						return true;
+					}
+					uint64_t h = detail::hash(nullptr, 0, uint64_t(width) << 32 | uint64_t(height) << 3 | uint64_t(bpp));
+					for (int y = 0; y < height; ++y) h = detail::hash(pixels + std::size_t(y) * stride, std::size_t(width) * bpp, h);
+
+					auto it = std::find_if(uploaded_.begin(), uploaded_.end(), [&](const uploaded& u) { return u.id == id; });
+					if (it != uploaded_.end() && it->hash == h) {
+						char cmd[32];
+						char* out = graphics::detail::put(cmd, "\x1b_Ga=p,i=");
+						out = graphics::detail::put_u32(out, id);
+						out = graphics::detail::put(out, ",q=2");
+						out = graphics::detail::put(out, st);
+						write(std::string_view{ cmd, std::size_t(out - cmd) });
+						return false;
+					}
+					transmit(pixels, width, height, stride, bpp, id, write);
+					if (it != uploaded_.end()) it->hash = h;
+					else uploaded_.push_back({ id, h });
+					return true;
+				}
+
+			public:
+				// 传输并在光标处显示 img (RGB, f=24), 输出依次交给 write(std::string_view)
+				// id 非 0 时复用该编号: 内容与上次相同则只输出放置命令; 返回是否传输了像素数据
+				template <class Write>
+				bool render_to(const graphics::image_view& img, uint32_t id, Write&& write) {
+					return render_to(img.rgb, img.width, img.height, img.stride, 3, id, write);
+				}
+
+				// RGBA 图像 (f=32)
+				template <class Write>
+				bool render_to(const graphics::rgba_view& img, uint32_t id, Write&& write) {
+					return render_to(img.rgba, img.width, img.height, img.stride, 4, id, write);
+				}
+
+				template <class Image>
+				std::string render(const Image& img, uint32_t id = 0) {
+					std::string result;
+					render_to(img, id, [&](std::string_view v) { result.append(v); });
+					return result;
+				}
+
+				// 删除终端中编号为 id 的图像并释放其数据, 之后同一编号的帧会重新传输
+				[[nodiscard]] std::string erase(uint32_t id) {
+					std::erase_if(uploaded_, [&](const uploaded& u) { return u.id == id; });
+					char cmd[32];
+					char* out = graphics::detail::put(cmd, "\x1b_Ga=d,d=I,i=");
+					out = graphics::detail::put_u32(out, id);
+					out = graphics::detail::put(out, ",q=2");
+					out = graphics::detail::put(out, st);
+					return { cmd, std::size_t(out - cmd) };
+				}
+			};
+
+			template <class Image>
+			inline std::string render(const Image& img) {
+				return encoder{}.render(img);
+			}
+		} // namespace kitty
+	}
+}
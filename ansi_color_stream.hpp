@@ -0,0 +1,189 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright (c) 2025 TAO 12804985@qq.com
+ *
+ * @file    ansi_color_stream.hpp
+ * @brief   std::ostream / std::wostream 输出: operator<< 与按流判定的 TTY 策略
+ * @version 1.2.0
+ * @date    2025-10-04
+ * 
+ * -----------------------------------------------------------------------------
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * -----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "ansi_color_core.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace ansi_escape {
+
+	namespace tty {
+
+		inline bool emit_ansi(std::ostream& os) {
+			if (&os == &std::cout)
+				return emit_policy(g_tty_state.stdout_policy, g_tty_state.stdout_is_tty);
+			else if (&os == &std::cerr)
+				return emit_policy(g_tty_state.stderr_policy, g_tty_state.stderr_is_tty);
+			else
+				return emit_policy(g_tty_state.stream_policy, false);
+		}
+
+		inline bool emit_ansi(std::wostream& os) {
+			if (&os == &std::wcout)
+				return emit_policy(g_tty_state.stdout_policy, g_tty_state.stdout_is_tty);
+			else if (&os == &std::wcerr)
+				return emit_policy(g_tty_state.stderr_policy, g_tty_state.stderr_is_tty);
+			else
+				return emit_policy(g_tty_state.stream_policy, false);
+		}
+
+		template <class CharT>
+		inline bool emit_ansi(std::basic_ostream<CharT>&) {
+			return emit_policy(g_tty_state.stream_policy, false);
+		}
+	}
+
+	namespace stats {
+		template <class CharT>
+		inline sink of(const std::basic_ostream<CharT>& os) noexcept {
+			const void* p = &os;
+			if (p == &std::cout || p == &std::wcout) return sink::out;
+			if (p == &std::cerr || p == &std::wcerr || p == &std::clog || p == &std::wclog) return sink::err;
+			return sink::other;
+		}
+	}
+
+	namespace detail {
+		// char 文本写入宽字符流: 在栈上按块逐字节扩展, 不分配内存
+		template <class CharT>
+		inline void write_widened(std::basic_ostream<CharT>& os, std::string_view v) {
+			CharT buf[64];
+			for (std::size_t i = 0; i < v.size(); i += std::size(buf)) {
+				std::size_t n = std::min(v.size() - i, std::size(buf));
+				for (std::size_t j = 0; j < n; ++j) buf[j] = static_cast<CharT>(static_cast<unsigned char>(v[i + j]));
+				os.write(buf, static_cast<std::streamsize>(n));
+			}
+		}
+	}
+
+	// 输出到 std::ostream / std::wostream / ...; char 的 AnsiLiteral 写入宽字符流时经 widen<CharT>() 一次写出,
+	// 常量对象的扩展结果在编译期确定; 运行期生成的 Style 等缓冲逐字节扩展
+	template <class CharT, typename AnsiObjectT>
+		requires ansi_object<AnsiObjectT, CharT> || ansi_object<AnsiObjectT>
+	inline std::basic_ostream<CharT>& operator<<(std::basic_ostream<CharT>& os, AnsiObjectT&& ao) {
+		const bool on = tty::emit_ansi(os);
+		stats::sequence(stats::of(os), on, ao.to_view().size());
+		if (!on) return os;
+		if constexpr (ansi_object<AnsiObjectT, CharT>) {
+			return os << ao.to_view();
+		}
+		else if constexpr (requires { ao.template widen<CharT>(); }) {
+			const auto w = ao.template widen<CharT>();
+			return os.write(w.c_str(), static_cast<std::streamsize>(ao.to_view().size()));
+		}
+		else {
+			detail::write_widened(os, ao.to_view());
+			return os;
+		}
+	}
+
+	template <class CharT, std::size_t N, std::size_t P>
+	inline std::basic_ostream<CharT>& operator<<(std::basic_ostream<CharT>& os, const AnsiText<N, P>& text) {
+		const bool on = tty::emit_ansi(os);
+		stats::colored_text(stats::of(os), on, text.colored_view(), text.plain_len);
+		auto v = text.view(on);
+		if constexpr (std::is_same_v<CharT, char>)
+			return os.write(v.data(), static_cast<std::streamsize>(v.size()));
+		else
+			detail::write_widened(os, v);
+		return os;
+	}
+
+	// 样式栈: 进入嵌套作用域时输出与外层的差异, 离开时只恢复变化的部分, 不使用完整的 reset
+	//   ansi_escape::style_stack styles(std::cout);
+	//   auto red = styles.enter(Style{}.fg16(1));
+	//   { auto b = styles.enter(Style{ styles.current() }.set(Style::bold)); ... } // 离开时输出 "\x1b[22m"
+	class style_stack {
+	public:
+		using Style = csi::sgr::Style;
+
+		// base 为栈底样式, 即终端当前的状态 (缺省为终端默认样式)
+		explicit style_stack(std::ostream& os, Style base = {}) : os_(os) { stack_[0] = base; }
+		style_stack(const style_stack&) = delete;
+		style_stack& operator=(const style_stack&) = delete;
+
+		static constexpr int max_depth = 31;
+
+		const Style& current() const noexcept { return stack_[depth_]; }
+		int depth() const noexcept { return depth_; }
+
+		// 超过 max_depth 层时抛出 std::length_error, 不输出任何内容
+		void push(const Style& s) {
+			if (depth_ >= max_depth) throw std::length_error("ansi_escape::style_stack: nested too deeply");
+			stack_[depth_ + 1] = s;
+			write(stack_[depth_], s);
+			++depth_;
+		}
+
+		// 多余的 pop 不做任何事, 不越界
+		void pop() {
+			assert(depth_ > 0 && "style_stack underflow");
+			if (depth_ == 0) return;
+			--depth_;
+			write(stack_[depth_ + 1], stack_[depth_]);
+		}
+
+		// 作用域结束时自动 pop
+		class scope {
+			style_stack* s_;
+		public:
+			explicit scope(style_stack& s) noexcept : s_(&s) {}
+			scope(scope&& o) noexcept : s_(std::exchange(o.s_, nullptr)) {}
+			scope(const scope&) = delete;
+			scope& operator=(const scope&) = delete;
+			scope& operator=(scope&&) = delete;
+			~scope() { if (s_) s_->pop(); }
+		};
+
+		[[nodiscard]] scope enter(const Style& s) {
+			push(s);
+			return scope{ *this };
+		}
+
+	private:
+		std::ostream& os_;
+		std::array<Style, max_depth + 1> stack_{}; // [0] 为栈底
+		int depth_ = 0;
+
+		void write(const Style& from, const Style& to) {
+			if (from == to) return;
+			const bool on = tty::emit_ansi(os_);
+			char buf[Style::max_transition];
+			const char* end = Style::transition(from, to, buf);
+			stats::sequence(stats::of(os_), on, std::size_t(end - buf));
+			if (on) os_.write(buf, end - buf);
+		}
+	};
+
+}
@@ -0,0 +1,835 @@
+// 基准测试: 测量各输出路径的 ns/op 与 bytes/op, 每行输出一条 JSON 结果
+//   g++ -std=c++20 -O2 benchmark.cpp -o benchmark -pthread -lutil
+//   ./benchmark [filter]                 仅运行名称包含 filter 的项目
+//   ./benchmark --golden-write DIR       经伪终端运行渲染场景, 将捕获的字节流写入 DIR/<场景>.ans
+//   ./benchmark --golden-check DIR       与 DIR 中的捕获比对, 不一致时返回非零; 仓库中的捕获在 golden/ 下
+//                                        两种模式都会以参考解码器校验 sixel 编码的往返结果
+//                                        以 -DANSI_COLOR_ENABLE_STATS 编译时还会将输出计数与捕获的字节数比对
+#include "ansi_color.hpp"
+#include "ansi_color_graphics.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <termios.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <util.h>
+#else
+#include <pty.h>
+#endif
+#endif
+
+namespace bench {
+
+	using namespace ansi_color;
+	using clock = std::chrono::steady_clock;
+
+	// 阻止编译器优化掉结果
+	template <class T>
+	inline void keep(const T& v) {
+#if defined(_MSC_VER)
+		static volatile const void* sink;
+		sink = &v;
+#else
+		asm volatile("" : : "g"(&v) : "memory");
+#endif
+	}
+
+	// 丢弃所有输出, 只统计字节数
+	class null_buf : public std::streambuf {
+		char buf_[4096];
+		std::size_t flushed_ = 0;
+	public:
+		null_buf() { setp(buf_, buf_ + sizeof(buf_)); }
+		std::size_t bytes() const { return flushed_ + std::size_t(pptr() - pbase()); }
+	protected:
+		int_type overflow(int_type c) override {
+			flushed_ += std::size_t(pptr() - pbase());
+			setp(buf_, buf_ + sizeof(buf_));
+			if (!traits_type::eq_int_type(c, traits_type::eof())) sputc(traits_type::to_char_type(c));
+			return traits_type::not_eof(c);
+		}
+	};
+
+#ifndef _WIN32
+	// 写入管道, 另一线程持续读空管道
+	class pipe_buf : public std::streambuf {
+		char buf_[65536];
+		std::size_t flushed_ = 0;
+		int fds_[2] = { -1, -1 };
+		std::thread drain_;
+	public:
+		pipe_buf() {
+			if (::pipe(fds_) != 0) std::abort();
+			drain_ = std::thread([fd = fds_[0]] {
+				char tmp[65536];
+				while (::read(fd, tmp, sizeof(tmp)) > 0) {}
+			});
+			setp(buf_, buf_ + sizeof(buf_));
+		}
+		~pipe_buf() override {
+			sync();
+			::close(fds_[1]);
+			drain_.join();
+			::close(fds_[0]);
+		}
+		int fd() const { return fds_[1]; }
+		std::size_t bytes() const { return flushed_ + std::size_t(pptr() - pbase()); }
+	protected:
+		int sync() override {
+			for (const char* p = pbase(); p < pptr(); ) {
+				auto w = ::write(fds_[1], p, std::size_t(pptr() - p));
+				if (w <= 0) return -1;
+				p += w;
+				flushed_ += std::size_t(w);
+			}
+			setp(buf_, buf_ + sizeof(buf_));
+			return 0;
+		}
+		int_type overflow(int_type c) override {
+			if (sync() != 0) return traits_type::eof();
+			if (!traits_type::eq_int_type(c, traits_type::eof())) sputc(traits_type::to_char_type(c));
+			return traits_type::not_eof(c);
+		}
+	};
+
+	// 写入伪终端从端 (raw 模式, 不做换行转换), 另一线程从主端读空, 可选择保存读到的字节
+	// 从端是真正的终端, 因此 isatty 为真, tty::policy::auto_ 会输出 ANSI
+	class pty_buf : public std::streambuf {
+		char buf_[65536];
+		std::size_t flushed_ = 0;
+		int master_ = -1, slave_ = -1;
+		std::atomic<std::size_t> drained_{ 0 };
+		std::atomic<bool> capturing_{ false };
+		std::mutex capture_mutex_;
+		std::string capture_;
+		std::thread drain_;
+	public:
+		pty_buf() {
+			if (::openpty(&master_, &slave_, nullptr, nullptr, nullptr) != 0) std::abort();
+			termios t{};
+			::tcgetattr(slave_, &t);
+			::cfmakeraw(&t);
+			::tcsetattr(slave_, TCSANOW, &t);
+			drain_ = std::thread([this] {
+				char tmp[65536];
+				for (;;) {
+					auto r = ::read(master_, tmp, sizeof(tmp));
+					if (r <= 0) break; // 从端关闭后 Linux 返回 EIO
+					if (capturing_.load(std::memory_order_relaxed)) {
+						std::lock_guard lock(capture_mutex_);
+						capture_.append(tmp, std::size_t(r));
+					}
+					drained_.fetch_add(std::size_t(r), std::memory_order_release);
+				}
+			});
+			setp(buf_, buf_ + sizeof(buf_));
+		}
+		~pty_buf() override {
+			sync();
+			::close(slave_);
+			drain_.join();
+			::close(master_);
+		}
+		int fd() const { return slave_; }
+		std::size_t bytes() const { return flushed_ + std::size_t(pptr() - pbase()); }
+
+		// 刷出缓冲并等待读取方取走全部已写入的字节
+		void drain() {
+			sync();
+			while (drained_.load(std::memory_order_acquire) < flushed_) std::this_thread::yield();
+		}
+
+		// 开始捕获; take_capture() 等待读空后返回捕获内容并停止捕获
+		void start_capture() {
+			drain();
+			std::lock_guard lock(capture_mutex_);
+			capture_.clear();
+			capturing_.store(true, std::memory_order_relaxed);
+		}
+		std::string take_capture() {
+			drain();
+			capturing_.store(false, std::memory_order_relaxed);
+			std::lock_guard lock(capture_mutex_);
+			return std::move(capture_);
+		}
+
+		// 外部直接写入 fd() 的字节 (如 emit) 需计入, 以便 drain() 等待
+		void add_external(std::size_t n) { flushed_ += n; }
+	protected:
+		int sync() override {
+			for (const char* p = pbase(); p < pptr(); ) {
+				auto w = ::write(slave_, p, std::size_t(pptr() - p));
+				if (w <= 0) return -1;
+				p += w;
+				flushed_ += std::size_t(w);
+			}
+			setp(buf_, buf_ + sizeof(buf_));
+			return 0;
+		}
+		int_type overflow(int_type c) override {
+			if (sync() != 0) return traits_type::eof();
+			if (!traits_type::eq_int_type(c, traits_type::eof())) sputc(traits_type::to_char_type(c));
+			return traits_type::not_eof(c);
+		}
+	};
+#endif
+
+	std::string_view g_filter;
+
+	// 运行 op 至少 100ms; bytes 返回迄今为止输出的总字节数
+	template <class Op>
+	void run(std::string_view name, std::string_view sink, const std::function<std::size_t()>& bytes, Op&& op) {
+		if (name.find(g_filter) == name.npos) return;
+
+		for (int i = 0; i < 1000; ++i) op();
+		const std::size_t bytes0 = bytes();
+		std::size_t iterations = 0;
+		const auto t0 = clock::now();
+		auto elapsed = clock::duration{};
+		do {
+			for (int i = 0; i < 1024; ++i) op();
+			iterations += 1024;
+			elapsed = clock::now() - t0;
+		} while (elapsed < std::chrono::milliseconds(100));
+
+		const double ns = std::chrono::duration<double, std::nano>(elapsed).count() / double(iterations);
+		const double per_op = double(bytes() - bytes0) / double(iterations);
+		std::cout << std::format(R"({{"bench":"{}","sink":"{}","ns_per_op":{:.2f},"bytes_per_op":{:.1f},"iterations":{}}})",
+			name, sink, ns, per_op, iterations) << std::endl;
+	}
+
+	// operator<< 及 ansi_escape::format 经 std::ostream 的输出路径
+	void stream_paths(std::ostream& os, std::string_view sink, const std::function<std::size_t()>& bytes) {
+		constexpr auto fg = fg24(255, 128, 0);
+		constexpr auto label = fg4::red + style::bold + "FAIL" + reset;
+		const auto title = osc::Title("benchmark");
+		int index = 0;
+
+		run("stream/Code", sink, bytes, [&] { os << fg4::red; });
+		run("stream/Color8", sink, bytes, [&] { os << fg8(uint8_t(index++)); });
+		run("stream/Color8::ref", sink, bytes, [&] { os << fg8::ref(uint8_t(index++)); });
+		run("stream/Color24", sink, bytes, [&] { os << fg; });
+		run("stream/Title", sink, bytes, [&] { os << title; });
+		run("stream/AnsiText", sink, bytes, [&] { os << label; });
+		run("stream/line", sink, bytes, [&] { os << fg4::red << bg4::black << "colored text" << reset << '\n'; });
+
+		// 同一个绝对样式: 逐个输出字面量 与 Style 的单个 CSI
+		constexpr auto cell = Style{}.fg16(1).bg256(236).set(Style::bold | Style::underline);
+		run("stream/style literals", sink, bytes, [&] { os << reset << fg4::red << bg8::ref(236) << style::bold << style::underline; });
+		run("stream/Style::sgr", sink, bytes, [&] { os << cell.sgr(); });
+		run("stream/ansi_escape::format", sink, bytes, [&] { ansi_escape::format(os, "{}{}{}\n", fg, int(index++), reset); });
+	}
+
+	// 表格: 行背景交替, 每个单元格只设置前景色; 比较恢复行背景的几种方式的字节数
+	void table_paths(std::ostream& os, std::string_view sink, const std::function<std::size_t()>& bytes) {
+		constexpr int rows = 20, cols = 6;
+		constexpr uint8_t row_bg[] = { 236, 238 };
+		constexpr std::string_view text = " cell ";
+
+		// reset 同时清除了背景, 每个单元格都要重新输出行背景
+		run("table/full reset", sink, bytes, [&] {
+			for (int r = 0; r < rows; ++r) {
+				for (int c = 0; c < cols; ++c)
+					os << bg8::ref(row_bg[r & 1]) << fg8::ref(uint8_t(c + 1)) << text << reset;
+				os << '\n';
+			}
+		});
+		// 单元格结束只取消前景色, 行背景保留到行尾
+		run("table/cancel codes", sink, bytes, [&] {
+			for (int r = 0; r < rows; ++r) {
+				os << bg8::ref(row_bg[r & 1]);
+				for (int c = 0; c < cols; ++c)
+					os << fg8::ref(uint8_t(c + 1)) << text << sgr::cancel::fg;
+				os << sgr::cancel::bg << '\n';
+			}
+		});
+		// 按状态差异切换, 每次在选择性取消与完整重设之间取较短者
+		run("table/Style transitions", sink, bytes, [&] {
+			Style cur{};
+			for (int r = 0; r < rows; ++r) {
+				for (int c = 0; c < cols; ++c) {
+					Style next = Style{}.bg256(row_bg[r & 1]).fg256(uint8_t(c + 1));
+					os << Style::sgr(cur, next) << text;
+					cur = next;
+				}
+				os << Style::sgr(cur, Style{}) << '\n';
+				cur = Style{};
+			}
+		});
+		run("table/styled", sink, bytes, [&] {
+			for (int r = 0; r < rows; ++r) {
+				os << bg8::ref(row_bg[r & 1]);
+				for (int c = 0; c < cols; ++c)
+					ansi_escape::format(os, "{:fg=red}", ansi_escape::styled(text));
+				os << sgr::cancel::bg << '\n';
+			}
+		});
+	}
+
+	void format_paths() {
+		std::size_t total = 0;
+		auto bytes = [&] { return total; };
+		auto add = [&](const std::string& s) { total += s.size(); keep(s); };
+		const auto fg = fg24(255, 128, 0);
+		const auto pal = fg8(208);
+		volatile int value = 42;
+
+		run("format/{}", "string", bytes, [&] { add(std::format("{}", fg)); });
+		run("format/{:f}", "string", bytes, [&] { add(std::format("{:f}", fg)); });
+		run("format/{:n}", "string", bytes, [&] { add(std::format("{:n}", fg)); });
+		run("format/{:a}", "string", bytes, [&] { add(std::format("{:a}", fg)); });
+		run("format/{:f256}", "string", bytes, [&] { add(std::format("{:f256}", fg)); });
+		run("format/{:f16}", "string", bytes, [&] { add(std::format("{:f16}", fg)); });
+		run("format/{:ftc} Color8", "string", bytes, [&] { add(std::format("{:ftc}", pal)); });
+		run("format/{:hex}", "string", bytes, [&] { add(std::format("{:hex}", fg)); });
+		run("format/line", "string", bytes, [&] { add(std::format("{:f}{:f}{}{:f}", fg4::red, bg4::black, int(value), reset)); });
+		run("format/styled", "string", bytes, [&] { add(std::format("{:f;fg=#f00;bold}", styled(int(value)))); });
+
+		ansi_escape::tty::scoped_target target{ true };
+		run("format/markup", "string", bytes, [&] { add("<red>{}</red> <bold>ok</bold>"_markup(int(value))); });
+		const ansi_escape::styled_template<int> tpl("<red>{}</red> <bold>ok</bold>");
+		run("format/styled_template", "string", bytes, [&] { add(tpl.render(int(value))); });
+
+		char buf[64];
+		run("format/format_to_n", "buffer", bytes, [&] {
+			auto r = ansi_escape::format_to_n(buf, "{:f}{}{:f}", fg4::red, int(value), reset);
+			total += std::size_t(r.out - buf);
+			keep(buf);
+		});
+		run("format/styled_template render_to", "buffer", bytes, [&] {
+			char* end = tpl.render_to(buf, true, int(value));
+			total += std::size_t(end - buf);
+			keep(buf);
+		});
+		Style cell = Style{}.bg256(236).set(Style::bold);
+		run("format/Style::encode", "buffer", bytes, [&] {
+			cell.fg256(uint8_t(value));
+			char* end = cell.encode(buf);
+			total += std::size_t(end - buf);
+			keep(buf);
+		});
+	}
+
+	void construction_paths() {
+		auto none = [] { return std::size_t(0); };
+		volatile uint8_t r = 255, g = 128, b = 0, i = 208;
+		const std::string hex = "#FF8000";
+		const std::string text = "ANSI COLOR BENCHMARK TITLE";
+
+		run("construct/Color24(r,g,b)", "none", none, [&] { auto c = fg24(r, g, b); keep(c); });
+		run("construct/Color24(hex)", "none", none, [&] { auto c = fg24(std::string_view(hex)); keep(c); });
+		run("construct/Color8", "none", none, [&] { auto c = fg8(i); keep(c); });
+		run("construct/Color8::ref", "none", none, [&] { auto c = fg8::ref(i); keep(c); });
+		run("construct/Title", "none", none, [&] { auto t = osc::Title(std::string_view(text)); keep(t); });
+	}
+
+	// 整帧渲染: 每帧耗时在毫秒级, 不走 run() 的迭代计数, 固定渲染 frames 帧取平均
+	template <class Op>
+	void run_frames(std::string_view name, int frames, Op&& op) {
+		if (name.find(g_filter) == name.npos) return;
+
+		std::size_t bytes = op(); // 预热
+		const auto t0 = clock::now();
+		for (int i = 0; i < frames; ++i) bytes = op();
+		const double ms = std::chrono::duration<double, std::milli>(clock::now() - t0).count() / frames;
+		std::cout << std::format(R"({{"bench":"{}","ms_per_frame":{:.2f},"bytes_per_frame":{},"frames":{}}})", name, ms, bytes, frames) << std::endl;
+	}
+
+	void graphics_paths() {
+		namespace gfx = ansi_escape::graphics;
+		// 4K 渐变图像, 相邻像素几乎都不同, 接近最坏情况
+		const int w = 3840, h = 2160;
+		std::vector<uint8_t> pixels(std::size_t(w) * h * 3);
+		for (int y = 0; y < h; ++y)
+			for (int x = 0; x < w; ++x) {
+				uint8_t* p = &pixels[(std::size_t(y) * w + x) * 3];
+				p[0] = uint8_t(x * 255 / w); p[1] = uint8_t(y * 255 / h); p[2] = uint8_t((x ^ y) & 0xFF);
+			}
+		const gfx::image_view img{ pixels.data(), w, h, std::size_t(w) * 3 };
+
+		for (auto [name, depth] : { std::pair{ "graphics/halfblock 4K truecolor", gfx::color_depth::truecolor },
+			std::pair{ "graphics/halfblock 4K 256", gfx::color_depth::c256 }, std::pair{ "graphics/halfblock 4K 16", gfx::color_depth::c16 } }) {
+			gfx::halfblock::renderer renderer;
+			run_frames(name, 5, [&] {
+				std::size_t n = 0;
+				renderer.render_to(img, depth, 0, [&](std::string_view band) { n += band.size(); keep(band); });
+				return n;
+			});
+		}
+
+		ansi_escape::dcs::sixel::renderer sixel;
+		run_frames("graphics/sixel 4K", 3, [&] {
+			std::size_t n = 0;
+			sixel.render_to(img, 0, [&](std::string_view part) { n += part.size(); keep(part); });
+			return n;
+		});
+
+		std::vector<uint8_t> rgba(std::size_t(w) * h * 4);
+		for (std::size_t i = 0, j = 0; i < pixels.size(); i += 3, j += 4) {
+			std::memcpy(&rgba[j], &pixels[i], 3);
+			rgba[j + 3] = 0xFF;
+		}
+		const gfx::rgba_view rgba_img{ rgba.data(), w, h, std::size_t(w) * 4 };
+		ansi_escape::apc::kitty::encoder kitty;
+		run_frames("graphics/kitty 4K RGBA", 5, [&] {
+			std::size_t n = 0;
+			kitty.render_to(rgba_img, 0, [&](std::string_view part) { n += part.size(); keep(part); });
+			return n;
+		});
+		// 同一编号的未变化帧: 只计算散列并输出放置命令
+		run_frames("graphics/kitty 4K RGBA unchanged", 5, [&] {
+			std::size_t n = 0;
+			kitty.render_to(rgba_img, 1, [&](std::string_view part) { n += part.size(); keep(part); });
+			return n;
+		});
+
+		// 盲文画布: 每帧清空后绘制 10 万个点 (4 种颜色) 并输出, 200×50 单元格
+		gfx::braille::canvas canvas(200, 50);
+		std::vector<std::pair<int, int>> points(100000);
+		uint32_t seed = 1;
+		for (auto& [x, y] : points) {
+			seed = seed * 1103515245 + 12345; x = int(seed >> 8) % canvas.width();
+			seed = seed * 1103515245 + 12345; y = int(seed >> 8) % canvas.height();
+		}
+		const auto series = { fg8::ref(45), fg8::ref(196), fg8::ref(226), fg8::ref(118) };
+		std::string frame(canvas.capacity(), '\0');
+		run_frames("graphics/braille 100k points", 100, [&] {
+			canvas.clear();
+			for (std::size_t i = 0; i < points.size(); ++i) canvas.set(points[i].first, points[i].second, series.begin()[i & 3]);
+			const std::size_t n = std::size_t(canvas.render(frame.data()) - frame.data());
+			keep(frame);
+			return n;
+		});
+		// 10 万个采样经 series 按列分桶 (每列约 250 个) 画成折线
+		std::vector<double> samples100k(100000);
+		for (std::size_t i = 0; i < samples100k.size(); ++i) samples100k[i] = double((i * 7919) % 1000) / 10.0;
+		run_frames("graphics/braille series 100k samples", 100, [&] {
+			canvas.clear();
+			canvas.series(samples100k, 0.0, 100.0, fg8::ref(45));
+			const std::size_t n = std::size_t(canvas.render(frame.data()) - frame.data());
+			keep(frame);
+			return n;
+		});
+
+		// 一屏 1000 条迷你折线 (每条 60 个值) 与 1000 行条形图, 带渐变色, 写入预先分配的缓冲区
+		std::vector<float> samples(60000);
+		for (std::size_t i = 0; i < samples.size(); ++i) samples[i] = float((i * 7919) % 1000) / 10.0f;
+		const gfx::scale<float> percent(0.0f, 100.0f);
+		const gfx::gradient heat({ { 0, 160, 0 }, { 255, 200, 0 }, { 220, 0, 0 } }, gfx::color_depth::c256);
+		std::vector<char> screen(1000 * gfx::sparkline::capacity(60, true));
+		run_frames("graphics/sparkline 1000x60 gradient", 100, [&] {
+			char* out = screen.data();
+			for (std::size_t i = 0; i < samples.size(); i += 60)
+				out = gfx::sparkline::render(std::span<const float>(samples).subspan(i, 60), percent, heat, out);
+			keep(screen);
+			return std::size_t(out - screen.data());
+		});
+		std::vector<char> bars(1000 * (gfx::bar::capacity(40, true) + 1));
+		run_frames("graphics/bar 1000 rows gradient", 100, [&] {
+			char* out = gfx::bar::rows(std::span<const float>(samples).first(1000), percent, 40, &heat, bars.data());
+			keep(bars);
+			return std::size_t(out - bars.data());
+		});
+	}
+
+#ifndef _WIN32
+	// 伪终端吞吐: 写入 count 次后等待读取方读空, 输出含读空在内的 ns/op 以及写完之后的读空耗时
+	template <class Op>
+	void run_drained(std::string_view name, pty_buf& pty, std::ostream& os, std::size_t count, Op&& op) {
+		if (name.find(g_filter) == name.npos) return;
+
+		pty.drain();
+		const std::size_t bytes0 = pty.bytes();
+		const auto t0 = clock::now();
+		for (std::size_t i = 0; i < count; ++i) op();
+		os.flush();
+		const auto t1 = clock::now();
+		pty.drain();
+		const auto t2 = clock::now();
+
+		using ns = std::chrono::duration<double, std::nano>;
+		std::cout << std::format(R"({{"bench":"{}","sink":"pty","ns_per_op":{:.2f},"bytes_per_op":{:.1f},"iterations":{},"drain_ns":{:.0f}}})",
+			name, ns(t2 - t0).count() / double(count), double(pty.bytes() - bytes0) / double(count), count, ns(t2 - t1).count()) << std::endl;
+	}
+
+	void pty_paths(pty_buf& pty, std::ostream& os) {
+		constexpr auto label = fg4::red + style::bold + "FAIL" + reset;
+		int index = 0;
+		run_drained("pty/line", pty, os, 100000, [&] { os << fg4::red << bg4::black << "colored text" << reset << '\n'; });
+		run_drained("pty/AnsiText", pty, os, 100000, [&] { os << label << '\n'; });
+		run_drained("pty/palette row", pty, os, 10000, [&] {
+			for (int c = 0; c < 80; ++c) os << bg8::ref(uint8_t(index++)) << ' ';
+			os << reset << '\n';
+		});
+		run_drained("pty/ansi_escape::format", pty, os, 100000, [&] { ansi_escape::format(os, "{}{}{}\n", fg24(255, 128, 0), index++, reset); });
+	}
+
+	// 图形场景的固定输入: 平滑渐变叠加少量重复色块, 覆盖游程与颜色切换
+	inline std::vector<uint8_t> golden_image(int w, int h, int channels) {
+		std::vector<uint8_t> pixels(std::size_t(w) * h * channels);
+		for (int y = 0; y < h; ++y)
+			for (int x = 0; x < w; ++x) {
+				uint8_t* p = &pixels[(std::size_t(y) * w + x) * channels];
+				const bool block = (x / 4 + y / 4) % 3 == 0;
+				p[0] = block ? 200 : uint8_t(x * 255 / std::max(w - 1, 1));
+				p[1] = block ? 40 : uint8_t(y * 255 / std::max(h - 1, 1));
+				p[2] = block ? 40 : uint8_t((x * 7 + y * 13) & 0xFF);
+				if (channels == 4) p[3] = uint8_t(255 - x);
+			}
+		return pixels;
+	}
+
+	inline void write_view(std::ostream& os, std::string_view v) { os.write(v.data(), std::streamsize(v.size())); }
+
+	// 渲染场景: 每个场景的完整输出经伪终端捕获, 与保存的字节流逐字节比对
+	struct scenario {
+		std::string_view name;
+		std::function<void(pty_buf&, std::ostream&)> render;
+	};
+
+	inline const scenario g_scenarios[] = {
+		{ "stream_line", [](pty_buf&, std::ostream& os) { os << fg4::red << bg4::black << "colored text" << reset << '\n'; } },
+		{ "ansi_text", [](pty_buf&, std::ostream& os) { constexpr auto t = fg4::green + style::bold + "OK" + reset; os << t << '\n'; } },
+		{ "palette", [](pty_buf&, std::ostream& os) { for (int i = 0; i < 256; ++i) os << bg8(uint8_t(i)) << ' '; os << reset << '\n'; } },
+		{ "format_depths", [](pty_buf&, std::ostream& os) {
+			const auto c = fg24(255, 128, 0);
+			ansi_escape::format(os, "{:f}a{:f256}b{:f16}c{:f}\n", c, c, c, reset);
+		} },
+		{ "markup", [](pty_buf&, std::ostream& os) { os << "<red>{}</red> <bold>{}</bold>\n"_markup(42, "ok"); } },
+		// 运行期解析的 styled 格式说明: 正常的组合, 以及重复 fg= 超出 64 字节缓冲时报告 std::format_error
+		{ "styled_spec", [](pty_buf&, std::ostream& os) {
+			const int value = 7;
+			auto v = styled(value);
+			for (std::string_view spec : { "{:f;fg=#fff;bg=236;bold;underline}", "{:f;fg=#fff;fg=#fff;fg=#fff;fg=#fff}" }) {
+				try { os << std::vformat(spec, std::make_format_args(v)) << '\n'; }
+				catch (const std::format_error& e) { os << "format_error: " << e.what() << '\n'; }
+			}
+		} },
+		// 有界格式化的截断: 完整输出为 "ab\e[31mhello\e[0m" (16 字节)
+		// n=4 截在转义序列中间; n=7 紧接开始的 SGR 之后, 放不下 reset; n=11 同样在 SGR 之后, 恰好放得下 reset
+		// n=13 截在结尾的 reset 中间, 补写 reset 需回退文本; n=16 不截断
+		{ "format_to_n", [](pty_buf&, std::ostream& os) {
+			for (std::size_t n : { 0, 4, 7, 11, 13, 16 }) {
+				char buf[16];
+				const auto r = ansi_escape::format_to_n(buf, n, "ab{:f}{}{:f}", fg4::red, "hello", reset);
+				os << std::format("n={} size={} truncated={} [", n, r.size, r.truncated);
+				os.write(buf, r.out - buf);
+				os << "]\n";
+			}
+		} },
+		// 样式栈: 嵌套进入 / 离开只恢复变化的部分; 超过 max_depth 时抛出且不输出; 到底后多余的 pop 不输出
+		// 多余的 pop 在调试构建中触发断言, 因此只在 NDEBUG 构建中执行, 两种构建的捕获相同
+		{ "style_stack", [](pty_buf&, std::ostream& os) {
+			using ansi_escape::style_stack;
+			{
+				style_stack styles(os);
+				auto outer = styles.enter(Style{}.fg16(1).bg256(236));
+				{ auto bold = styles.enter(Style{ styles.current() }.set(Style::bold)); os << 'B'; }
+				os << 'R';
+				{ auto green = styles.enter(Style{ styles.current() }.fg16(2)); os << 'G'; }
+			}
+			os << '\n';
+
+			style_stack styles(os);
+			for (int i = 0; i < style_stack::max_depth; ++i) styles.push(Style{}.fg256(uint8_t(i)));
+			try { styles.push(Style{}.fg16(1)); os << "|no length_error|"; }
+			catch (const std::length_error&) { os << "|length_error depth=" << styles.depth() << '|'; }
+			while (styles.depth() > 0) styles.pop();
+#ifdef NDEBUG
+			styles.pop();
+#endif
+			os << "depth=" << styles.depth() << '\n';
+		} },
+		// 输出策略为 auto_ 时按 isatty 判定: 伪终端从端应输出 ANSI
+		{ "emit_auto_tty", [](pty_buf& pty, std::ostream&) {
+			auto prev = tty::g_tty_state.stream_policy;
+			tty::g_tty_state.stream_policy = tty::policy::auto_;
+			constexpr auto t = fg4::yellow + "auto" + reset;
+			ansi_escape::emit(pty.fd(), t);
+			pty.add_external(t.colored_len);
+			tty::g_tty_state.stream_policy = prev;
+		} },
+		// 图形渲染: 固定输入, 验证各渲染器优化前后输出不变
+		{ "halfblock", [](pty_buf&, std::ostream& os) {
+			namespace gfx = ansi_escape::graphics;
+			const auto pixels = golden_image(24, 13, 3);
+			const gfx::image_view img{ pixels.data(), 24, 13, 24 * 3 };
+			gfx::halfblock::renderer renderer;
+			for (auto depth : { gfx::color_depth::truecolor, gfx::color_depth::c256, gfx::color_depth::c16 })
+				renderer.render_to(img, depth, 2, [&](std::string_view v) { write_view(os, v); });
+		} },
+		{ "sixel", [](pty_buf&, std::ostream& os) {
+			namespace gfx = ansi_escape::graphics;
+			const auto pixels = golden_image(24, 13, 3);
+			ansi_escape::dcs::sixel::renderer renderer;
+			renderer.render_to(gfx::image_view{ pixels.data(), 24, 13, 24 * 3 }, 2, [&](std::string_view v) { write_view(os, v); });
+			os << '\n';
+		} },
+		{ "kitty", [](pty_buf&, std::ostream& os) {
+			namespace gfx = ansi_escape::graphics;
+			// 40×30 RGBA 为 4800 字节, 超过一块 (3072 字节), 覆盖 m=1 / m=0 分块; 第二次以同一编号输出只有放置命令
+			const auto pixels = golden_image(40, 30, 4);
+			const gfx::rgba_view img{ pixels.data(), 40, 30, 40 * 4 };
+			ansi_escape::apc::kitty::encoder encoder;
+			for (int i = 0; i < 2; ++i) encoder.render_to(img, 7, [&](std::string_view v) { write_view(os, v); });
+			write_view(os, encoder.erase(7));
+			os << '\n';
+		} },
+		{ "braille", [](pty_buf&, std::ostream& os) {
+			namespace gfx = ansi_escape::graphics;
+			gfx::braille::canvas canvas(30, 6);
+			std::vector<double> wave(500);
+			for (std::size_t i = 0; i < wave.size(); ++i) wave[i] = double(i % 200 < 100 ? i % 200 : 200 - i % 200); // 三角波, 每列约 8 个采样
+			canvas.series(wave, 0.0, 100.0, fg8::ref(45));
+			canvas.line(0, 23, 59, 0, fg24(255, 128, 0));
+			canvas.set(59, 23, csi::sgr::Style{}.fg16(9).set(csi::sgr::Style::bold));
+			write_view(os, canvas.render());
+		} },
+		{ "sparkline_bar", [](pty_buf&, std::ostream& os) {
+			namespace gfx = ansi_escape::graphics;
+			const std::vector<int> values = { 0, 3, 7, 12, 18, 25, 33, 42, 50, 61, 70, 80, 90, 100, 120, -5 };
+			const gfx::scale<int> percent(0, 100);
+			const gfx::gradient heat({ { 0, 160, 0 }, { 255, 200, 0 }, { 220, 0, 0 } }, gfx::color_depth::c256);
+			char buf[4096];
+			char* out = gfx::sparkline::render(values, percent, buf);
+			*out++ = '\n';
+			out = gfx::sparkline::render(values, percent, heat, out);
+			*out++ = '\n';
+			out = gfx::bar::rows(std::span(values).first(8), percent, 12, &heat, out);
+			out = gfx::bar::render(55, percent, 12, out);
+			*out++ = '\n';
+			*out++ = '|';
+			out = gfx::bar::render(55, percent, -3, out); // 负宽度按 0 处理, 不输出任何内容
+			*out++ = '|';
+			*out++ = '\n';
+			os.write(buf, out - buf);
+		} },
+	};
+
+	// sixel 参考解码器: 与编码器独立实现, 返回每个像素的颜色寄存器 (未绘制为 -1); 格式错误时返回空
+	// 同时检查每个用到的寄存器都已按 256 色表定义
+	std::optional<std::vector<int>> sixel_decode(std::string_view s, int width, int height) {
+		if (!s.starts_with("\x1bPq") || !s.ends_with("\x1b\\")) return std::nullopt;
+		s = s.substr(3, s.size() - 5);
+		std::size_t i = 0;
+		auto number = [&] {
+			int v = 0;
+			while (i < s.size() && s[i] >= '0' && s[i] <= '9') v = v * 10 + (s[i++] - '0');
+			return v;
+		};
+		auto expect = [&](char c) { return i < s.size() && s[i++] == c; };
+
+		std::vector<int> pixels(std::size_t(width) * height, -1);
+		std::array<bool, 256> defined{};
+		int x = 0, y = 0, reg = -1;
+		while (i < s.size()) {
+			const char c = s[i];
+			if (c == '"') {
+				++i;
+				const int pan = number(); if (!expect(';')) return std::nullopt;
+				const int pad = number(); if (!expect(';')) return std::nullopt;
+				const int w = number(); if (!expect(';')) return std::nullopt;
+				const int h = number();
+				if (pan != 1 || pad != 1 || w != width || h != height) return std::nullopt;
+			}
+			else if (c == '#') {
+				++i;
+				reg = number();
+				if (reg > 255) return std::nullopt;
+				if (i < s.size() && s[i] == ';') {
+					++i;
+					if (number() != 2) return std::nullopt;
+					int pct[3];
+					for (int& p : pct) { if (!expect(';')) return std::nullopt; p = number(); }
+					const auto& rgb = ansi_escape::detail::palette_rgb[reg];
+					if (pct[0] != (rgb.r * 100 + 127) / 255 || pct[1] != (rgb.g * 100 + 127) / 255 || pct[2] != (rgb.b * 100 + 127) / 255) return std::nullopt;
+					defined[reg] = true;
+				}
+			}
+			else if (c == '$') { ++i; x = 0; }
+			else if (c == '-') { ++i; x = 0; y += 6; }
+			else {
+				int count = 1;
+				if (c == '!') { ++i; count = number(); }
+				if (i >= s.size() || s[i] < '?' || s[i] > '~' || reg < 0 || !defined[reg]) return std::nullopt;
+				const int bits = s[i++] - '?';
+				for (int k = 0; k < count; ++k, ++x)
+					for (int r = 0; r < 6; ++r) {
+						if (!(bits >> r & 1)) continue;
+						if (x >= width || y + r >= height) return std::nullopt;
+						pixels[std::size_t(y + r) * width + x] = reg;
+					}
+			}
+		}
+		return pixels;
+	}
+
+	// sixel 往返校验: 固定输入在不同尺寸与线程数下编码, 解码结果应等于逐像素 rgb_to_256; 返回失败数
+	int sixel_roundtrip() {
+		namespace gfx = ansi_escape::graphics;
+		int failures = 0;
+		for (auto [w, h] : { std::pair{ 1, 1 }, { 7, 5 }, { 13, 6 }, { 64, 37 }, { 0, 13 }, { 5, 0 }, { 300, 200 } }) {
+			std::vector<uint8_t> pixels(std::size_t(w) * h * 3);
+			uint32_t seed = uint32_t(w * 131 + h);
+			for (std::size_t i = 0; i < pixels.size(); ++i) {
+				seed = seed * 1103515245 + 12345;
+				// 前半为随机像素, 后半为平滑渐变, 覆盖短游程与长游程
+				pixels[i] = i < pixels.size() / 2 ? uint8_t(seed >> 16) : uint8_t(i / 3 % std::size_t(std::max(w, 1)) * 4);
+			}
+			const gfx::image_view img{ pixels.data(), w, h, std::size_t(w) * 3 };
+			std::vector<int> want(std::size_t(w) * h);
+			for (int y = 0; y < h; ++y)
+				for (int x = 0; x < w; ++x) want[std::size_t(y) * w + x] = ansi_escape::detail::rgb_to_256(img.at(x, y));
+
+			for (unsigned threads : { 1u, 3u, 4u }) {
+				ansi_escape::dcs::sixel::renderer renderer;
+				const auto got = sixel_decode(renderer.render(img, threads), w, h);
+				const bool ok = got && *got == want;
+				failures += !ok;
+				std::cout << std::format(R"({{"roundtrip":"sixel {}x{} threads={}","status":"{}"}})", w, h, threads, ok ? "ok" : "mismatch") << std::endl;
+			}
+		}
+		return failures;
+	}
+
+	// 计数校验: 经各输出路径写入伪终端, 计数器中的转义字节与文本字节应等于捕获中 CSI 序列与其余部分的字节数
+	// 需以 -DANSI_COLOR_ENABLE_STATS 编译; 返回失败数
+	int stats_check(pty_buf& pty, std::ostream& os) {
+		namespace stats = ansi_escape::stats;
+		if constexpr (!stats::enabled) {
+			std::cout << R"({"stats":"all","status":"disabled"})" << std::endl;
+			return 0;
+		}
+		const std::pair<std::string_view, std::function<void()>> cases[] = {
+			{ "format(os)", [&] { ansi_escape::format(os, "{}hello {}{}\n", fg4::red, 42, reset); } },
+			{ "format(os) AnsiText", [&] { constexpr auto t = fg4::yellow + "warn" + reset; ansi_escape::format(os, "[{}] {}\n", t, 3); } },
+			{ "format(os) styled", [&] { ansi_escape::format(os, "[{:fg=#f00;bold}]\n", styled(7)); } },
+			{ "format_to", [&] {
+				std::string s;
+				ansi_escape::format_to(std::back_inserter(s), tty::policy::force, "{:f256}{}{}\n", fg24(255, 128, 0), "text", reset);
+				os << s;
+			} },
+			{ "operator<< AnsiText", [&] { constexpr auto t = fg4::green + "OK" + reset + "\n"; os << t; } },
+			{ "emit parts", [&] {
+				constexpr std::string_view colored = "colored", text = " text\n";
+				ansi_escape::emit(pty.fd(), { { fg4::red.to_view(), colored }, { reset.to_view(), text } });
+				pty.add_external(fg4::red.to_view().size() + colored.size() + reset.to_view().size() + text.size());
+			} },
+		};
+		int failures = 0;
+		for (const auto& [name, render] : cases) {
+			stats::reset();
+			pty.start_capture();
+			render();
+			os.flush();
+			const std::string got = pty.take_capture();
+
+			std::size_t escape_bytes = 0;
+			for (std::size_t i = 0; i + 1 < got.size(); ++i) {
+				if (got[i] != '\x1b' || got[i + 1] != '[') continue;
+				std::size_t e = i + 2;
+				while (e < got.size() && (got[e] < 0x40 || got[e] > 0x7E)) ++e;
+				escape_bytes += e + 1 - i;
+				i = e;
+			}
+			const auto c = stats::read().total();
+			const bool ok = c.escape_bytes == escape_bytes && c.text_bytes == got.size() - escape_bytes;
+			failures += !ok;
+			std::cout << std::format(R"({{"stats":"{}","escape_bytes":{},"text_bytes":{},"captured_escape_bytes":{},"captured_text_bytes":{},"status":"{}"}})",
+				name, c.escape_bytes, c.text_bytes, escape_bytes, got.size() - escape_bytes, ok ? "ok" : "mismatch") << std::endl;
+		}
+		return failures;
+	}
+
+	// mode 为 "--golden-write" 或 "--golden-check"; 返回不一致的场景数
+	int golden(std::string_view mode, const std::string& dir) {
+		pty_buf pty;
+		std::ostream os(&pty);
+		int failures = 0;
+		for (const auto& s : g_scenarios) {
+			pty.start_capture();
+			s.render(pty, os);
+			os.flush();
+			const std::string got = pty.take_capture();
+			const std::string path = dir + "/" + std::string(s.name) + ".ans";
+
+			std::string_view status = "written";
+			if (mode == "--golden-write") {
+				std::ofstream(path, std::ios::binary) << got;
+			}
+			else {
+				std::ifstream in(path, std::ios::binary);
+				const std::string want{ std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+				status = !in ? "missing" : got == want ? "ok" : "mismatch";
+				failures += status != "ok";
+			}
+			std::cout << std::format(R"({{"golden":"{}","bytes":{},"status":"{}"}})", s.name, got.size(), status) << std::endl;
+		}
+		return failures + stats_check(pty, os) + sixel_roundtrip();
+	}
+
+	// 不经 std::ostream 的输出路径, 每次调用一次系统调用
+	void fd_paths(int fd, std::string_view sink, const std::function<std::size_t()>& bytes, std::size_t& total) {
+		constexpr auto label = fg4::red + "FAIL" + reset;
+		run("fd/emit Code", sink, bytes, [&] { ansi_escape::emit(fd, fg4::red); total += fg4::red.to_view().size(); });
+		run("fd/emit AnsiText", sink, bytes, [&] { ansi_escape::emit(fd, label); total += label.colored_len; });
+		run("fd/emit parts", sink, bytes, [&] {
+			constexpr std::string_view colored = "colored", text = " text\n";
+			ansi_escape::emit(fd, { { fg4::red.to_view(), colored }, { reset.to_view(), text } });
+			total += fg4::red.to_view().size() + colored.size() + reset.to_view().size() + text.size();
+		});
+	}
+#endif
+}
+
+int main(int argc, char* argv[]) {
+	using namespace ansi_color;
+
+	// 基准测试关心的是输出代价, 因此对非终端目标也强制输出 ANSI
+	tty::g_tty_state.stream_policy = tty::policy::force;
+
+#ifndef _WIN32
+	if (argc > 2 && (argv[1] == std::string_view("--golden-write") || argv[1] == std::string_view("--golden-check")))
+		return bench::golden(argv[1], argv[2]) == 0 ? 0 : 1;
+#endif
+	if (argc > 1) bench::g_filter = argv[1];
+
+	{
+		bench::null_buf buf;
+		std::ostream os(&buf);
+		bench::stream_paths(os, "null", [&] { return buf.bytes(); });
+		bench::table_paths(os, "null", [&] { return buf.bytes(); });
+	}
+#ifndef _WIN32
+	{
+		bench::pipe_buf buf;
+		std::ostream os(&buf);
+		bench::stream_paths(os, "pipe", [&] { return buf.bytes(); });
+
+		std::size_t total = 0;
+		bench::fd_paths(buf.fd(), "pipe", [&] { return total; }, total);
+	}
+	{
+		bench::pty_buf buf;
+		std::ostream os(&buf);
+		bench::pty_paths(buf, os);
+	}
+#endif
+	bench::format_paths();
+	bench::construction_paths();
+	bench::graphics_paths();
+
+	return 0;
+}
@@ -0,0 +1,38 @@
+#!/bin/sh
+# 编译期开销测试: 生成 TUS 个包含头文件的翻译单元并逐个编译, 输出总耗时与单个 TU 平均耗时
+#   ./compile_benchmark.sh [header] [tus]
+#   CXX=clang++ CXXFLAGS="-O2" ./compile_benchmark.sh ansi_color.hpp 200
+set -e
+
+HEADER=${1:-ansi_color.hpp}
+TUS=${2:-100}
+CXX=${CXX:-c++}
+CXXFLAGS=${CXXFLAGS:-}
+SRC_DIR=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+i=0
+while [ "$i" -lt "$TUS" ]; do
+	cat > "$WORK/tu$i.cpp" <<EOF
+#include "$HEADER"
+using namespace ansi_color;
+const char* tu$i(int k) {
+	static auto fg = fg8(k);
+	static auto bg = bg8(255 - k);
+	return k & 1 ? fg.c_str() : bg.c_str();
+}
+EOF
+	i=$((i + 1))
+done
+
+start=$(date +%s%N)
+i=0
+while [ "$i" -lt "$TUS" ]; do
+	$CXX -std=c++20 $CXXFLAGS -I"$SRC_DIR" -c "$WORK/tu$i.cpp" -o "$WORK/tu$i.o"
+	i=$((i + 1))
+done
+end=$(date +%s%N)
+
+total_ms=$(( (end - start) / 1000000 ))
+echo "{\"header\":\"$HEADER\",\"tus\":$TUS,\"total_ms\":$total_ms,\"ms_per_tu\":$((total_ms / TUS))}"
@@ -38,6 +38,8 @@ int main(int argc, char* argv[]) {
 	std::cout << std::format("{:a}{:a}Automatically detect TTY and output ANSI{:a}", "#FF0000"_fg, "#FFff00"_bg, reset) << std::endl;
 	std::cout << std::format("{:n}{:n}Disable ANSI output{:n}", "#FF0000"_fg, "#FFff00"_bg, reset) << std::endl;
 	std::cout << std::format("{:f}{:f}Force ANSI sequences into text output (redirected with > out.txt){:f}", "#FF0000"_fg, "#FFff00"_bg, reset) << std::endl; 
+	std::cout << std::format("{:fg=#F00;bg=yellow;bold} {:fg=208|>8}", styled("red on yellow"), styled(42)) << std::endl;
+	std::cout << "<red>{} on <bg=yellow>yellow</bg=yellow></red> <bold>markup</bold>"_markup("red") << std::endl;
 	std::cout << std::endl;
 	
 	std::cout << style::underline << style::bold << "ANSI COLOR TEST DONE" << reset << std::endl;